@@ -20,6 +20,7 @@
 
 #include "ATParser.h"
 #include "mbed_debug.h"
+#include "ATTrace.h"
 
 #ifdef LF
 #undef LF
@@ -35,6 +36,7 @@
 #define CR  13
 #endif
 #define MIN(a,b) (((a)<(b))?(a):(b))
+#define MAX(a,b) (((a)>(b))?(a):(b))
 
 #define dbg_on 0
 //#define TRACE_AT_DATA 1
@@ -42,19 +44,19 @@
 // getc/putc handling with timeouts
 int ATParser::putc(char c)
 {
-    return _serial_spi->putc(c);
+    return _transport->putc(c);
 }
 
 int ATParser::getc()
 {
-    return _serial_spi->getc();
+    return _transport->getc();
 }
 
 void ATParser::flush()
 {
     _bufferMutex.lock();
-    while (_serial_spi->readable()) {
-        _serial_spi->getc();
+    while (_transport->readable()) {
+        _transport->getc();
     }
     _bufferMutex.unlock();
 }
@@ -62,6 +64,7 @@ void ATParser::flush()
 // read/write handling with timeouts
 int ATParser::write(const char *data, int size_of_data, int size_in_buff)
 {
+    ATTRACE_SCOPE("at_write");
     int i = 0;
     _bufferMutex.lock();
     for ( ; i < size_of_data; i++) {
@@ -71,26 +74,41 @@ int ATParser::write(const char *data, int size_of_data, int size_in_buff)
         }
     }
 
-    _serial_spi->buffsend(size_of_data + size_in_buff);
+    uint32_t start = profile_now();
+    ssize_t ret = _transport->buffsend(size_of_data + size_in_buff);
+    profile_transfer(start, ret, true);
+    _failures = (ret < 0) ? (_failures + 1) : 0;
     _bufferMutex.unlock();
     return (size_of_data + size_in_buff);
 }
 
-int ATParser::read(char *data)
+int ATParser::read(char *data, int size)
+{
+    ATTRACE_SCOPE("at_read");
+    _bufferMutex.lock();
+    uint32_t start = profile_start();
+    int ret = _read(data, size);
+    profile_parse(start, ret >= 0);
+    _bufferMutex.unlock();
+
+    return ret;
+}
+
+int ATParser::_read(char *data, int size)
 {
     int readsize;
     int i = 0;
 
     _bufferMutex.lock();
 
-    //this->flush();
-    if(!_serial_spi->readable()) {
-        readsize = _serial_spi->read();
-    } else {
-        error("Pending data when reading from WIFI\r\n");
-        return -1;
+    if (_transport->readable()) {
+        /* Leftover of a previous response that was not fully parsed */
+        debug_if(dbg_on, "Pending data when reading from WIFI, flushed\r\n");
+        flush();
     }
 
+    readsize = transport_read();
+
     debug_if(dbg_on, "Avail in SPI %d\r\n", readsize);
 
     if ( readsize < 0) {
@@ -98,6 +116,13 @@ int ATParser::read(char *data)
         return -1;
     }
 
+    if (readsize > size) {
+        debug_if(dbg_on, "Frame too large (%d > %d), dropped\r\n", readsize, size);
+        flush();
+        _bufferMutex.unlock();
+        return -1;
+    }
+
     for (i = 0 ; i < readsize; i++) {
        int c = getc();
        if (c < 0) {
@@ -128,6 +153,8 @@ int ATParser::vprintf(const char *format, va_list args)
         _bufferMutex.unlock();
         return false;
     }
+    profile_command(_buffer);
+    policy_command(_buffer);
 
     int i = 0;
     for ( ; _buffer[i]; i++) {
@@ -211,6 +238,7 @@ int ATParser::vscanf(const char *format, va_list args)
 // Command parsing with line handling
 bool ATParser::vsend(const char *command, va_list args)
 {
+    ATTRACE_SCOPE("at_send");
     int i=0, j=0;
     _bufferMutex.lock();
     // Create and send command
@@ -226,8 +254,14 @@ bool ATParser::vsend(const char *command, va_list args)
         _buffer[i+j] = _delimiter[j];
     }
     _buffer[i+j]=0; // only to get a clean debug log
-    
-    bool ret = !(_serial_spi->buffwrite(_buffer, i+j) < 0);
+    profile_command(_buffer);
+    policy_command(_buffer);
+
+    uint32_t start = profile_now();
+    ssize_t written = _transport->buffwrite(_buffer, i+j);
+    profile_transfer(start, written, true);
+    _failures = (written < 0) ? (_failures + 1) : 0;
+    bool ret = !(written < 0);
 
     debug_if(dbg_on, "AT> %s\n", _buffer);
     _bufferMutex.unlock();
@@ -235,13 +269,26 @@ bool ATParser::vsend(const char *command, va_list args)
 }
 
 bool ATParser::vrecv(const char *response, va_list args)
+{
+    ATTRACE_SCOPE("at_recv");
+    _bufferMutex.lock();
+    uint32_t start = profile_start();
+    bool ret = _vrecv(response, args);
+    profile_parse(start, ret);
+    _bufferMutex.unlock();
+
+    return ret;
+}
+
+bool ATParser::_vrecv(const char *response, va_list args)
 {
     _bufferMutex.lock();
     /* Read from the wifi module, fill _rxbuffer */
     //this->flush();
-    if(!_serial_spi->readable()) {
+    if(!_transport->readable()) {
          debug_if(dbg_on, "NO DATA, read again\r\n");
-        if (_serial_spi->read() < 0) {
+        if (transport_read() < 0) {
+            _bufferMutex.unlock();
             return false;
         }
     } else {
@@ -423,5 +470,239 @@ void ATParser::abort()
     _aborted = true;
 }
 
+// log2 histograms of durations in us. When a bucket is full, all of them
+// are halved: the shape, and so the percentiles, are kept, the older samples
+// weighing less than the new ones
+static void histogram_add(uint16_t *hist, uint32_t us)
+{
+    int bucket = 0;
+
+    while ((us >>= 1) && (bucket < (ATPARSER_PROFILE_BUCKETS - 1))) {
+        bucket++;
+    }
+    if (hist[bucket] == 0xFFFF) {
+        for (int i = 0; i < ATPARSER_PROFILE_BUCKETS; i++) {
+            /* rounded up, a bucket with samples is not emptied */
+            hist[i] = (hist[i] + 1) / 2;
+        }
+    }
+    hist[bucket]++;
+}
+
+ssize_t ATParser::transport_read(void)
+{
+    uint32_t start = profile_now();
+    uint32_t policy_start = _policy.classes ? us_ticker_read() : 0;
+
+    ssize_t ret = _transport->read();
+
+    profile_transfer(start, ret, false);
+    _failures = (ret < 0) ? (_failures + 1) : 0;
+    if ((ret >= 0) && _policy.current) {
+        histogram_add(_policy.current->hist, us_ticker_read() - policy_start);
+        if (_policy.current->samples < ATPARSER_TIMEOUT_MIN_SAMPLES) {
+            _policy.current->samples++;
+        }
+    }
+
+    return ret;
+}
+
+// Adaptive timeouts
+void ATParser::setTimeoutPolicy(int percent, int multiple, int floor_ms, int ceiling_ms)
+{
+    _bufferMutex.lock();
+    if (percent == 0) {
+        delete[] _policy.classes;
+        _policy.classes = NULL;
+    } else if (_policy.classes == NULL) {
+        _policy.classes = new timeout_class[ATPARSER_PROFILE_COMMANDS];
+        memset(_policy.classes, 0, ATPARSER_PROFILE_COMMANDS * sizeof(timeout_class));
+    }
+    _policy.current = NULL;
+    _policy.percent = percent;
+    _policy.multiple = multiple;
+    _policy.floor_ms = floor_ms;
+    _policy.ceiling_ms = ceiling_ms;
+    _transport->setTimeout(_timeout);
+    _bufferMutex.unlock();
+}
+
+void ATParser::policy_command(const char *command)
+{
+    if (_policy.classes == NULL) {
+        return;
+    }
+
+    _policy.current = NULL;
+    for (int i = 0; i < ATPARSER_PROFILE_COMMANDS; i++) {
+        if (_policy.classes[i].prefix[0] == 0) {
+            strncpy(_policy.classes[i].prefix, command, 2);
+            _policy.current = &_policy.classes[i];
+            break;
+        }
+        if (strncmp(_policy.classes[i].prefix, command, 2) == 0) {
+            _policy.current = &_policy.classes[i];
+            break;
+        }
+    }
+
+    /* Keep the module timeout and its margin until enough responses were seen */
+    if ((_policy.current == NULL) || (_policy.current->samples < ATPARSER_TIMEOUT_MIN_SAMPLES)) {
+        _transport->setTimeout(_timeout);
+        return;
+    }
+
+    uint32_t guard = (percentile(_policy.current->hist, _policy.percent) * _policy.multiple + 999) / 1000;
+    guard = MAX(guard, _policy.floor_ms);
+    guard = MIN(guard, _policy.ceiling_ms);
+    /* Never give up on the link before the module itself times out */
+    guard = MAX(guard, (uint32_t)_timeout);
+    debug_if(dbg_on, "AT timeout %s: %lu ms\r\n", _policy.current->prefix, (unsigned long)guard);
+    _transport->setGuard(guard);
+}
 
+// Per command statistics
 
+void ATParser::profile_command(const char *command)
+{
+#if ATPARSER_PROFILE
+    uint32_t now = us_ticker_read();
+
+    if (_cmd) {
+        histogram_add(_cmd->latency, _cmd_end - _cmd_start);
+    }
+
+    _cmd = NULL;
+    for (int i = 0; i < ATPARSER_PROFILE_COMMANDS; i++) {
+        if (_stats[i].prefix[0] == 0) {
+            strncpy(_stats[i].prefix, command, 2);
+            _cmd = &_stats[i];
+            break;
+        }
+        if (strncmp(_stats[i].prefix, command, 2) == 0) {
+            _cmd = &_stats[i];
+            break;
+        }
+    }
+    if (_cmd) {
+        _cmd->count++;
+    }
+    _cmd_start = now;
+    _cmd_end = now;
+    _op_transfer = 0;
+#else
+    (void)command;
+#endif
+}
+
+void ATParser::profile_transfer(uint32_t start, ssize_t ret, bool tx)
+{
+#if ATPARSER_PROFILE
+    uint32_t now = us_ticker_read();
+    uint32_t elapsed = now - start;
+    uint32_t wait = MIN(_transport->wait_time(), elapsed);
+
+    _op_transfer += elapsed;
+    _cmd_end = now;
+    if (_cmd == NULL) {
+        return;
+    }
+
+    _cmd->wait_us += wait;
+    histogram_add(_cmd->wait, wait);
+    _cmd->transfer_us += elapsed - wait;
+    histogram_add(_cmd->transfer, elapsed - wait);
+    if (ret < 0) {
+        /* failed reads are accounted by profile_parse */
+        if (tx) {
+            _cmd->failures++;
+        }
+    } else if (tx) {
+        _cmd->bytes_tx += ret;
+    } else {
+        _cmd->bytes_rx += ret;
+    }
+#else
+    (void)start;
+    (void)ret;
+    (void)tx;
+#endif
+}
+
+void ATParser::profile_parse(uint32_t start, bool ok)
+{
+#if ATPARSER_PROFILE
+    uint32_t now = us_ticker_read();
+    uint32_t elapsed = now - start;
+    uint32_t parse = (elapsed > _op_transfer) ? (elapsed - _op_transfer) : 0;
+
+    _op_transfer = 0;
+    _cmd_end = now;
+    if (_cmd == NULL) {
+        return;
+    }
+
+    _cmd->parse_us += parse;
+    histogram_add(_cmd->parse, parse);
+    if (!ok) {
+        _cmd->failures++;
+    }
+#else
+    (void)start;
+    (void)ok;
+#endif
+}
+
+int ATParser::get_stats(at_command_stats_t *stats, int count)
+{
+    int n = 0;
+
+#if ATPARSER_PROFILE
+    _bufferMutex.lock();
+    while ((n < count) && (n < ATPARSER_PROFILE_COMMANDS) && _stats[n].prefix[0]) {
+        memcpy(&stats[n], &_stats[n], sizeof(at_command_stats_t));
+        n++;
+    }
+    _bufferMutex.unlock();
+#else
+    (void)stats;
+    (void)count;
+#endif
+
+    return n;
+}
+
+void ATParser::reset_stats(void)
+{
+#if ATPARSER_PROFILE
+    _bufferMutex.lock();
+    memset(_stats, 0, sizeof(_stats));
+    _cmd = NULL;
+    _op_transfer = 0;
+    _bufferMutex.unlock();
+#endif
+}
+
+uint32_t ATParser::percentile(const uint16_t *hist, int percent)
+{
+    uint32_t total = 0;
+    uint32_t sum = 0;
+
+    for (int i = 0; i < ATPARSER_PROFILE_BUCKETS; i++) {
+        total += hist[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint32_t target = (total * percent + 99) / 100;
+    for (int i = 0; i < ATPARSER_PROFILE_BUCKETS; i++) {
+        sum += hist[i];
+        if (sum >= target) {
+            return 2UL << i;
+        }
+    }
+
+    return 2UL << (ATPARSER_PROFILE_BUCKETS - 1);
+}
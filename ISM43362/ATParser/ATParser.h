@@ -23,9 +23,40 @@
 #include "mbed.h"
 #include <cstdarg>
 #include <vector>
-#include "BufferedSpi.h"
+#include "ATTransport.h"
 #include "Callback.h"
 
+/** Set to 1 to collect per command statistics, see ATParser::get_stats */
+#ifndef ATPARSER_PROFILE
+#define ATPARSER_PROFILE 0
+#endif
+
+/** Number of command prefixes tracked by the statistics */
+#define ATPARSER_PROFILE_COMMANDS 16
+
+/** Number of histogram buckets, bucket n counts durations of [2^n, 2^(n+1)) us,
+ *  the last one counts all longer durations */
+#define ATPARSER_PROFILE_BUCKETS 20
+
+/** Number of responses of a command before its timeout is adapted, see ATParser::setTimeoutPolicy */
+#define ATPARSER_TIMEOUT_MIN_SAMPLES 16
+
+/** Statistics of one command prefix (C?, P0, S3, R0...)
+ */
+typedef struct {
+    char prefix[3];         /*!< first 2 characters of the command */
+    uint32_t count;         /*!< commands sent */
+    uint32_t failures;      /*!< failed transfers, timeouts or unmatched responses */
+    uint32_t bytes_tx;      /*!< bytes sent to the module */
+    uint32_t bytes_rx;      /*!< bytes received from the module */
+    uint32_t wait_us;       /*!< total time waiting for the module to be ready */
+    uint32_t transfer_us;   /*!< total time clocking frames in and out */
+    uint32_t parse_us;      /*!< total time parsing responses */
+    uint16_t latency[ATPARSER_PROFILE_BUCKETS];     /*!< histogram of the time from send to the last response */
+    uint16_t wait[ATPARSER_PROFILE_BUCKETS];        /*!< histogram of the wait per frame */
+    uint16_t transfer[ATPARSER_PROFILE_BUCKETS];    /*!< histogram of the transfer per frame */
+    uint16_t parse[ATPARSER_PROFILE_BUCKETS];       /*!< histogram of the parse per response */
+} at_command_stats_t;
 
 /**
 * Parser class for parsing AT commands
@@ -47,8 +78,8 @@
 class ATParser
 {
 private:
-    // Serial information
-    BufferedSpi *_serial_spi;
+    // Transport information
+    ATTransport *_transport;
     int _buffer_size;
     char *_buffer;
     Mutex _bufferMutex;
@@ -60,6 +91,7 @@ private:
     char _in_prev;
     bool dbg_on;
     volatile bool _aborted;
+    volatile int _failures;
 
     struct oob {
         unsigned len;
@@ -69,20 +101,71 @@ private:
     };
     oob *_oobs;
 
+#if ATPARSER_PROFILE
+    at_command_stats_t _stats[ATPARSER_PROFILE_COMMANDS];
+    at_command_stats_t *_cmd;
+    uint32_t _cmd_start;
+    uint32_t _cmd_end;
+    uint32_t _op_transfer;
+#endif
+
+    // Statistics collection, compiled out unless ATPARSER_PROFILE is set
+    uint32_t profile_now(void)
+    {
+#if ATPARSER_PROFILE
+        return us_ticker_read();
+#else
+        return 0;
+#endif
+    }
+    uint32_t profile_start(void)
+    {
+#if ATPARSER_PROFILE
+        _op_transfer = 0;
+#endif
+        return profile_now();
+    }
+    void profile_command(const char *command);
+    void profile_transfer(uint32_t start, ssize_t ret, bool tx);
+    void profile_parse(uint32_t start, bool ok);
+
+    // Adaptive timeouts, per command prefix
+    struct timeout_class {
+        char prefix[3];
+        uint16_t hist[ATPARSER_PROFILE_BUCKETS];
+        uint32_t samples;
+    };
+    struct {
+        timeout_class *classes;
+        timeout_class *current;
+        int percent;
+        int multiple;
+        uint32_t floor_ms;
+        uint32_t ceiling_ms;
+    } _policy;
+    void policy_command(const char *command);
+    ssize_t transport_read(void);
+
+    bool _vrecv(const char *response, va_list args);
+    int _read(char *data, int size);
+
 public:
     /**
     * Constructor
     *
-    * @param serial spi interface to use for AT commands
+    * @param transport link to the module to use for AT commands (SPI or UART)
     * @param buffer_size size of internal buffer for transaction
     * @param timeout timeout of the connection
     * @param delimiter string of characters to use as line delimiters
     */
-    ATParser(BufferedSpi &serial_spi, const char *delimiter = "\r\n", int buffer_size = 1440, int timeout = 8000, bool debug = false) :
-        _serial_spi(&serial_spi),
-        _buffer_size(buffer_size), _in_prev(0), _oobs(NULL)
+    ATParser(ATTransport &transport, const char *delimiter = "\r\n", int buffer_size = 1440, int timeout = 8000, bool debug = false) :
+        _transport(&transport),
+        _buffer_size(buffer_size), _in_prev(0), _failures(0), _oobs(NULL)
     {
         _buffer = new char[buffer_size];
+        _policy.classes = NULL;
+        _policy.current = NULL;
+        reset_stats();
         setTimeout(timeout);
         setDelimiter(delimiter);
         debugOn(debug);
@@ -98,6 +181,7 @@ public:
             _oobs = oob->next;
             delete oob;
         }
+        delete[] _policy.classes;
         delete[] _buffer;
     }
 
@@ -109,7 +193,35 @@ public:
     void setTimeout(int timeout) 
     {
         _timeout = timeout;
-        _serial_spi->setTimeout(timeout);
+        _transport->setTimeout(timeout);
+    }
+
+    /**
+    * Adapt the link timeout of each command to its observed response time
+    *
+    * Once a command prefix got ATPARSER_TIMEOUT_MIN_SAMPLES responses, the link
+    * waits for its responses for multiple times the given percentile of their
+    * past response times, bounded by floor_ms and ceiling_ms, instead of the
+    * module timeout plus ATTRANSPORT_GUARD_MARGIN.
+    *
+    * @param percent percentile of the response times, 1-100, 0 to disable
+    * @param multiple factor applied to the percentile
+    * @param floor_ms shortest timeout
+    * @param ceiling_ms longest timeout
+    */
+    void setTimeoutPolicy(int percent, int multiple = 4, int floor_ms = 100, int ceiling_ms = 20000);
+
+    /**
+    * Change the link to the module, e.g. to insert a FaultTransport
+    *
+    * @param transport link to the module to use for AT commands
+    */
+    void setTransport(ATTransport &transport)
+    {
+        _bufferMutex.lock();
+        _transport = &transport;
+        _transport->setTimeout(_timeout);
+        _bufferMutex.unlock();
     }
 
     /**
@@ -194,10 +306,10 @@ public:
      * Read an array of bytes from the underlying stream
      *
      * @param data the destination for the read bytes
-     * @param size number of bytes to read
+     * @param size max number of bytes to read, the frame is dropped if larger
      * @return number of bytes read or -1 on failure
      */
-    int read(char *data);
+    int read(char *data, int size);
 
     /**
      * Direct printf to underlying stream
@@ -253,6 +365,43 @@ public:
     * @return true if oob data processed, false otherwise
     */
     bool process_oob(void);
+
+    /**
+    * Get the per command statistics
+    *
+    * Collected only when the library is built with ATPARSER_PROFILE set.
+    * The latency of the last command is accounted when the next one is sent.
+    *
+    * @param stats destination for the statistics
+    * @param count number of entries in stats
+    * @return number of entries filled
+    */
+    int get_stats(at_command_stats_t *stats, int count);
+
+    /**
+    * Clear the per command statistics
+    */
+    void reset_stats(void);
+
+    /**
+    * Get a percentile of a statistics histogram
+    *
+    * @param hist histogram of ATPARSER_PROFILE_BUCKETS buckets
+    * @param percent percentile to get, 1-100
+    * @return upper bound of the percentile in us, 0 if the histogram is empty
+    */
+    static uint32_t percentile(const uint16_t *hist, int percent);
+
+    /**
+    * Get the number of consecutive failed transfers
+    *
+    * A transfer fails when the module does not get ready or does not
+    * answer in time. The count restarts on the next successful transfer.
+    */
+    int failures(void) {
+        return _failures;
+    }
+
     /**
     * Get buffer_size
     */
@@ -0,0 +1,164 @@
+/* Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * Timeline of the driver activity, exported as a compact binary capture
+ *
+ */
+
+#include <string.h>
+#include "ATTrace.h"
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+static attrace_event_t *_events;
+static uint32_t _size;
+static uint32_t _head;
+static uint32_t _count;
+static volatile bool _running;
+
+/* Names are told apart by their address, a name used in several files can
+ * take several entries */
+static const char *_names[ATTRACE_MAX_NAMES];
+static uint32_t _name_count;
+static osThreadId _threads[ATTRACE_MAX_THREADS];
+static uint32_t _thread_count;
+
+void ATTrace::start(attrace_event_t *buffer, uint32_t count)
+{
+    core_util_critical_section_enter();
+    _events = buffer;
+    _size = count;
+    _head = 0;
+    _count = 0;
+    _name_count = 0;
+    _thread_count = 0;
+    _running = (buffer != NULL) && (count > 0);
+    core_util_critical_section_exit();
+}
+
+void ATTrace::stop(void)
+{
+    _running = false;
+}
+
+/* Index of a name, added to the table if new, called in the critical section */
+uint8_t ATTrace::name_index(const char *name)
+{
+    for (uint32_t i = 0; i < _name_count; i++) {
+        if (_names[i] == name) {
+            return i;
+        }
+    }
+    if (_name_count == ATTRACE_MAX_NAMES) {
+        return ATTRACE_UNKNOWN;
+    }
+    _names[_name_count] = name;
+    return _name_count++;
+}
+
+/* Index of a thread, added to the table if new, called in the critical section */
+uint8_t ATTrace::thread_index(osThreadId thread)
+{
+    for (uint32_t i = 0; i < _thread_count; i++) {
+        if (_threads[i] == thread) {
+            return i;
+        }
+    }
+    if (_thread_count == ATTRACE_MAX_THREADS) {
+        return ATTRACE_UNKNOWN;
+    }
+    _threads[_thread_count] = thread;
+    return _thread_count++;
+}
+
+void ATTrace::add(const char *name, char phase)
+{
+    if (!_running) {
+        return;
+    }
+
+    osThreadId thread = osThreadGetId();
+    core_util_critical_section_enter();
+    attrace_event_t *event = &_events[_head];
+    event->timestamp = us_ticker_read();
+    event->name = name_index(name);
+    event->thread = thread_index(thread);
+    event->phase = phase;
+    event->reserved = 0;
+    _head = (_head + 1) % _size;
+    if (_count < _size) {
+        _count++;
+    }
+    core_util_critical_section_exit();
+}
+
+void ATTrace::begin(const char *name)
+{
+    add(name, 'B');
+}
+
+void ATTrace::end(const char *name)
+{
+    add(name, 'E');
+}
+
+static void write_stdout(const void *data, uint32_t size)
+{
+    fwrite(data, 1, size, stdout);
+}
+
+/* The events are written as stored: the capture is converted on the host,
+ * which knows the byte order of the target */
+uint32_t ATTrace::dump(Callback<void(const void *, uint32_t)> output)
+{
+    bool running = _running;
+    uint32_t count = _count;
+    uint32_t first = (_head + _size - _count) % (_size ? _size : 1);
+
+    /* events are not recorded while the buffer is read */
+    _running = false;
+
+    bool to_stdout = !output;
+    if (to_stdout) {
+        output = callback(write_stdout);
+    }
+
+    uint32_t magic = ATTRACE_MAGIC;
+    uint16_t version = ATTRACE_VERSION;
+    uint16_t names = _name_count;
+    output(&magic, sizeof(magic));
+    output(&version, sizeof(version));
+    output(&names, sizeof(names));
+    output(&count, sizeof(count));
+    for (uint32_t i = 0; i < _name_count; i++) {
+        output(_names[i], strlen(_names[i]) + 1);
+    }
+
+    /* oldest first, in two parts when the ring wrapped */
+    uint32_t part = MIN(count, _size - first);
+    if (part > 0) {
+        output(&_events[first], part * sizeof(attrace_event_t));
+    }
+    if (count > part) {
+        output(&_events[0], (count - part) * sizeof(attrace_event_t));
+    }
+    if (to_stdout) {
+        fflush(stdout);
+    }
+
+    _running = running;
+    return count;
+}
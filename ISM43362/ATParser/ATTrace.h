@@ -0,0 +1,137 @@
+/* Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * Timeline of the driver activity, exported as a compact binary capture
+ *
+ */
+
+#ifndef AT_TRACE_H
+#define AT_TRACE_H
+
+#include "mbed.h"
+
+/** Set to 1 to build the driver with tracing, see ATTrace */
+#ifndef ATTRACE
+#define ATTRACE 0
+#endif
+
+#if ATTRACE
+#define ATTRACE_BEGIN(name)     ATTrace::begin(name)
+#define ATTRACE_END(name)       ATTrace::end(name)
+#define ATTRACE_SCOPE(name)     ATTraceScope _attrace_scope(name)
+#else
+#define ATTRACE_BEGIN(name)
+#define ATTRACE_END(name)
+#define ATTRACE_SCOPE(name)
+#endif
+
+/** First word of a capture written by ATTrace::dump, "ATTR" */
+#define ATTRACE_MAGIC 0x52545441
+
+/** Version of the capture format */
+#define ATTRACE_VERSION 1
+
+/** Number of distinct section names, and of threads, told apart in a trace */
+#define ATTRACE_MAX_NAMES 64
+#define ATTRACE_MAX_THREADS 16
+
+/** Name or thread index of an event past the tables */
+#define ATTRACE_UNKNOWN 0xFF
+
+/** One begin or end event of the timeline, 8 bytes
+ */
+typedef struct {
+    uint32_t timestamp; /*!< us_ticker time in microseconds */
+    uint8_t name;       /*!< index of the section name in the capture */
+    uint8_t thread;     /*!< index of the thread, in the order of their first event */
+    uint8_t phase;      /*!< 'B' for begin, 'E' for end */
+    uint8_t reserved;
+} attrace_event_t;
+
+/**
+ * Ring buffer of timestamped begin/end events
+ *
+ * The driver marks mutex waits, data ready waits, SPI transfers, AT commands
+ * and socket operations. Events are stored once a buffer is given with
+ * start(), the oldest ones being overwritten. dump() writes them as a
+ * binary capture, which the host tool attrace_json converts to Chrome
+ * trace JSON, to be loaded in chrome://tracing or Perfetto.
+ */
+class ATTrace
+{
+public:
+    /** Start recording events
+     *
+     * @param buffer storage for the events
+     * @param count number of events in buffer
+     */
+    static void start(attrace_event_t *buffer, uint32_t count);
+
+    /** Stop recording events, recorded ones are kept until the next start
+     */
+    static void stop(void);
+
+    /** Record the beginning of a section
+     *
+     * @param name static string naming the section
+     */
+    static void begin(const char *name);
+
+    /** Record the end of a section
+     *
+     * @param name static string naming the section
+     */
+    static void end(const char *name);
+
+    /** Write the recorded events as a binary capture, oldest first
+     *
+     * The capture is, in the byte order of the target (little endian):
+     * the uint32_t ATTRACE_MAGIC, the uint16_t ATTRACE_VERSION, the uint16_t
+     * number of names, the uint32_t number of events, the NUL terminated
+     * names, then the events.
+     *
+     * @param output function called with each part of the capture, writing
+     *               to stdout when empty, which must not convert newlines
+     * @return number of events written
+     */
+    static uint32_t dump(Callback<void(const void *, uint32_t)> output = NULL);
+
+private:
+    static void add(const char *name, char phase);
+    static uint8_t name_index(const char *name);
+    static uint8_t thread_index(osThreadId thread);
+};
+
+/** Section traced from its construction to the end of the enclosing scope
+ */
+class ATTraceScope
+{
+public:
+    ATTraceScope(const char *name) : _name(name)
+    {
+        ATTrace::begin(name);
+    }
+
+    ~ATTraceScope()
+    {
+        ATTrace::end(_name);
+    }
+
+private:
+    const char *_name;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/* Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * Transport interface used by the AT command parser
+ *
+ */
+#ifndef AT_TRANSPORT_H
+#define AT_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/** Margin added to the module timeout before the link gives up on a response,
+ *  in milliseconds, see ATTransport::setTimeout */
+#ifndef ATTRANSPORT_GUARD_MARGIN
+#define ATTRANSPORT_GUARD_MARGIN 5000
+#endif
+
+/**
+ * Frame based link to the wifi module
+ *
+ * Commands are written as one frame, and each module response is read as
+ * one frame into an internal receive buffer, then consumed byte per byte.
+ */
+class ATTransport
+{
+public:
+    virtual ~ATTransport() {}
+
+    /** Check if bytes of the last read frame are left in the receive buffer
+     *  @return 1 if something exists, 0 otherwise
+     */
+    virtual int readable(void) = 0;
+
+    /** Get a single byte from the receive buffer
+     *  @return A byte of the last read frame, -1 if none is left
+     */
+    virtual int getc(void) = 0;
+
+    /** Append a single byte to the frame being built
+     *  @param c The byte to write
+     *  @return The byte that was written
+     */
+    virtual int putc(int c) = 0;
+
+    /** Write a complete frame to the module
+     *  @param s A pointer to data to send
+     *  @param length The amount of data being pointed to
+     *  @return The number of bytes written, negative on failure
+     */
+    virtual ssize_t buffwrite(const void *s, size_t length) = 0;
+
+    /** Send the frame built with putc
+     *  @param length number of bytes of the frame
+     *  @return The number of bytes written, negative on failure
+     */
+    virtual ssize_t buffsend(size_t length) = 0;
+
+    /** Wait for a frame from the module and store it in the receive buffer
+     *  @return The number of bytes read, negative on failure
+     */
+    virtual ssize_t read() = 0;
+
+    /** Set the timeout of the frame operations
+     *
+     *  The link waits up to the module timeout plus ATTRANSPORT_GUARD_MARGIN,
+     *  to only give up when the module is stuck.
+     *
+     *  @param timeout timeout of the module response, in milliseconds
+     */
+    virtual void setTimeout(int timeout) = 0;
+
+    /** Set how long the frame operations wait for the module, without margin
+     *  @param guard maximum wait, in milliseconds
+     */
+    virtual void setGuard(int guard) = 0;
+
+    /** Time spent waiting for the module to be ready in the last frame operation
+     *  @return time in microseconds, 0 if the link does not measure it
+     */
+    virtual uint32_t wait_time(void)
+    {
+        return 0;
+    }
+};
+
+#endif
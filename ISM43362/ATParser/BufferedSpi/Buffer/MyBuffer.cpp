@@ -51,7 +51,8 @@ template <class T>
     uint32_t MyBuffer<T>::getNbAvailable()
 {
     if ( _wloc >= _rloc) return (_wloc - _rloc);
-    else return (_size - _rloc + _wloc);
+    /* the indexes wrap at _size - 1, see put() and get() */
+    else return (_size - 1 - _rloc + _wloc);
 }
 
 template <class T>
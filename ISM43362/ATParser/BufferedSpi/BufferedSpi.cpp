@@ -24,6 +24,7 @@
 #include <stdarg.h>
 #include "mbed_debug.h"
 #include "mbed_error.h"
+#include "ATTrace.h"
 
 // change to true to add few SPI debug lines
 #define local_debug false
@@ -37,40 +38,65 @@ void BufferedSpi::DatareadyRising(void)
    }
 }
 
+void BufferedSpi::end_wait(uint8_t type, uint8_t status, uint32_t start)
+{
+    uint32_t waited = us_ticker_read() - start;
+    uint8_t payload[4] = { (uint8_t)waited, (uint8_t)(waited >> 8),
+                           (uint8_t)(waited >> 16), (uint8_t)(waited >> 24) };
+
+    _wait_us = waited;
+    if (_recorder == NULL) {
+        return;
+    }
+
+    _recorder->record(type, status, payload, sizeof(payload));
+}
+
 int BufferedSpi::wait_cmddata_rdy_high(void)
 {
+  ATTRACE_SCOPE("spi_ready_wait");
   Timer timer;
+  uint32_t start = us_ticker_read();
   timer.start();
 
   /* wait for dataready = 1 */
-  while(dataready.read() == 0) {
+  while(dataready_read() == 0) {
        if (timer.read_ms() > _timeout) {
           debug_if(local_debug,"ERROR: SPI write timeout\r\n");
+          end_wait(SpiRecorder::ReadyHigh, SpiRecorder::Timeout, start);
           return -1;
        }
   }
 
   _cmddata_rdy_rising_event = 1;
+  end_wait(SpiRecorder::ReadyHigh, SpiRecorder::Ok, start);
 
   return 0;
 }
 
 int BufferedSpi::wait_cmddata_rdy_rising_event(void)
 {
+    ATTRACE_SCOPE("spi_data_wait");
     Timer timer;
+    uint32_t start = us_ticker_read();
     timer.start();
 
     while (_cmddata_rdy_rising_event == 1) {
        if (timer.read_ms() > _timeout) {
+           uint8_t status = SpiRecorder::Timeout;
            _cmddata_rdy_rising_event = 0;
-           if (dataready.read() == 1) {
+           if (dataready_read() == 1) {
                debug_if(local_debug,"ERROR: We missed rising event !! (timemout=%d)\r\n", _timeout);
+               status = SpiRecorder::MissedEdge;
            }
            debug_if(local_debug,"ERROR: SPI read timeout\r\n");
+           end_wait(SpiRecorder::ReadyRise, status, start);
            return -1;
        }
     }
 
+    end_wait(SpiRecorder::ReadyRise, SpiRecorder::Ok, start);
+
     return 0;
 }
 
@@ -81,6 +107,8 @@ BufferedSpi::BufferedSpi(PinName mosi, PinName miso, PinName sclk, PinName _nss,
     this->_buf_size = buf_size;
     this->_tx_multiple = tx_multiple;
     this->_sigio_event = 0;
+    this->_recorder = NULL;
+    this->_wait_us = 0;
 
     _datareadyInt = new InterruptIn(_datareadypin);
     _datareadyInt->rise(callback(this, &BufferedSpi::DatareadyRising));
@@ -92,6 +120,7 @@ BufferedSpi::BufferedSpi(PinName mosi, PinName miso, PinName sclk, PinName _nss,
 
 BufferedSpi::~BufferedSpi(void)
 {
+    delete _datareadyInt;
 
     return;
 }
@@ -106,6 +135,21 @@ void BufferedSpi::format(int bits, int mode)
     SPI::format(bits, mode);
 }
 
+int BufferedSpi::spi_transfer(int value)
+{
+    return SPI::write(value);
+}
+
+int BufferedSpi::dataready_read(void)
+{
+    return dataready.read();
+}
+
+void BufferedSpi::record(SpiRecorder *recorder)
+{
+    _recorder = recorder;
+}
+
 void BufferedSpi::disable_nss()
 {
     nss = 1;
@@ -243,6 +287,7 @@ ssize_t BufferedSpi::read()
 
 ssize_t BufferedSpi::read(uint32_t max)
 {
+    ATTRACE_SCOPE("spi_read");
     uint32_t len = 0;
     int tmp;
 
@@ -254,16 +299,24 @@ ssize_t BufferedSpi::read(uint32_t max)
         return -1;
     }
 
+    if (_recorder) {
+        _recorder->begin(SpiRecorder::Rx);
+    }
+
     enable_nss();
-    while (dataready.read() == 1 && (len < (_buf_size - 1))) {
-        tmp = SPI::write(0xAA);  // dummy write to receive 2 bytes
+    while (dataready_read() == 1 && (len < (_buf_size - 1))) {
+        tmp = spi_transfer(0xAA);  // dummy write to receive 2 bytes
 
         if (!((len == 0) && (tmp == 0x0A0D))) {
             /* do not take into account the 2 firts \r \n char in the buffer */
             if ((max == 0) || (len < max)) {
-                _rxbuf = (char)(tmp & 0x00FF);
-                _rxbuf = (char)((tmp >>8)& 0xFF);
+                char word[2] = { (char)(tmp & 0x00FF), (char)((tmp >> 8) & 0xFF) };
+                _rxbuf = word[0];
+                _rxbuf = word[1];
                 len += 2;
+                if (_recorder) {
+                    _recorder->put(word, 2);
+                }
             }
         }
     }
@@ -271,9 +324,16 @@ ssize_t BufferedSpi::read(uint32_t max)
 
     if (len >= _buf_size) {
         debug_if(local_debug, "firmware ERROR ES_WIFI_ERROR_STUFFING_FOREVER\r\n");
+        if (_recorder) {
+            _recorder->end(SpiRecorder::Overflow);
+        }
         return -1;
     }
 
+    if (_recorder) {
+        _recorder->end(SpiRecorder::Ok);
+    }
+
     debug_if(local_debug, "SPI READ %d BYTES\r\n", len);
 
     return len;
@@ -281,16 +341,27 @@ ssize_t BufferedSpi::read(uint32_t max)
 
 void BufferedSpi::txIrq(void)
 { /* write everything available in the _txbuffer */
+    ATTRACE_SCOPE("spi_write");
     int value = 0;
     int dbg_cnt = 0;
+    if (_recorder) {
+        _recorder->begin(SpiRecorder::Tx);
+    }
     while (_txbuf.available() && (_txbuf.getNbAvailable()>0)) {
         value = _txbuf.get();
         if (_txbuf.available() && ((_txbuf.getNbAvailable()%2)!=0)) {
             value |= ((_txbuf.get()<<8)&0XFF00);
-            SPI::write(value);
+            spi_transfer(value);
             dbg_cnt++;
+            if (_recorder) {
+                char word[2] = { (char)(value & 0xFF), (char)((value >> 8) & 0xFF) };
+                _recorder->put(word, 2);
+            }
         }
     }
+    if (_recorder) {
+        _recorder->end(SpiRecorder::Ok);
+    }
     debug_if(local_debug, "SPI Sent %d BYTES\r\n", 2*dbg_cnt);
     // disable the TX interrupt when there is nothing left to send
     BufferedSpi::attach(NULL, BufferedSpi::TxIrq);
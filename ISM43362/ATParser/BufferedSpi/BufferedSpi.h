@@ -26,6 +26,8 @@
  
 #include "mbed.h"
 #include "MyBuffer.h"
+#include "ATTransport.h"
+#include "SpiRecorder.h"
 
 /** A spi port (SPI) for communication with wifi device
  *
@@ -68,7 +70,7 @@
  *  @class BufferedSpi
  *  @brief Software buffers and interrupt driven tx and rx for Serial
  */  
-class BufferedSpi : public SPI 
+class BufferedSpi : public SPI, public ATTransport
 {
 private:
     DigitalOut    nss;
@@ -81,7 +83,6 @@ private:
 
     InterruptIn* _datareadyInt;
     volatile int _cmddata_rdy_rising_event;
-    void DatareadyRising(void);
     int wait_cmddata_rdy_rising_event(void);
     int wait_cmddata_rdy_high(void);
 
@@ -91,6 +92,33 @@ private:
     Callback<void()> _sigio_cb;
     uint8_t          _sigio_event;
 
+    SpiRecorder     *_recorder;
+    uint32_t         _wait_us;
+    void end_wait(uint8_t type, uint8_t status, uint32_t start);
+
+protected:
+    /** Hardware access of the module link
+     *
+     *  All SPI transfers and data ready reads go through these functions,
+     *  together with enable_nss/disable_nss, so that a derived class can run
+     *  the driver against an emulated module instead of the real one.
+     */
+
+    /** Transfer one 16 bits word on the SPI bus
+     *  @param value word to send
+     *  @return word received
+     */
+    virtual int spi_transfer(int value);
+
+    /** Read the data ready line
+     *  @return 1 when the module has data or is ready for a command, 0 otherwise
+     */
+    virtual int dataready_read(void);
+
+    /** To be called on each rising edge of the data ready line
+     */
+    void DatareadyRising(void);
+
 public:
     MyBuffer <char> _rxbuf;
     DigitalIn dataready;
@@ -193,18 +221,47 @@ public:
     *
     * @param timeout timeout of the connection
     */
-    void setTimeout(int timeout)
+    virtual void setTimeout(int timeout)
     {
         /*  this is a safe guard timeout in case module is stuck
-         *  so take 5 sec margin compared to module timeout, to
+         *  so take a margin (5 sec by default) compared to module timeout, to
          *  really only detect case where module is stuck */
-        _timeout = timeout + 5000;
+        _timeout = timeout + ATTRANSPORT_GUARD_MARGIN;
+    }
+
+    /**
+    * Allows the safe guard timeout to be set directly
+    *
+    * @param guard maximum wait for the module, in milliseconds
+    */
+    virtual void setGuard(int guard)
+    {
+        _timeout = guard;
+    }
+
+    /**
+    * Time spent waiting for data ready in the last command or read
+    *
+    * @return wait in microseconds
+    */
+    virtual uint32_t wait_time(void)
+    {
+        return _wait_us;
     }
 
     /** Register a callback once any data is ready for sockets
      *  @param func     Function to call on state change
      */
     virtual void sigio(Callback<void()> func);
+
+    /** Record the frames exchanged with the module
+     *
+     *  Every frame sent or received, and every wait on the data ready line,
+     *  is logged into the recorder until it is detached.
+     *
+     *  @param recorder recorder to log into, NULL to stop recording
+     */
+    void record(SpiRecorder *recorder);
     
     /** Attach a function to call whenever a serial interrupt is generated
      *  @param func A pointer to a void function, or 0 to set as none
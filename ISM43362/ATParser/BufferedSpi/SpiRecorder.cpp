@@ -0,0 +1,141 @@
+/**
+ * @file    SpiRecorder.cpp
+ * @brief   Ring buffer recording of the SPI frames exchanged with the wifi device
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SpiRecorder.h"
+
+SpiRecorder::SpiRecorder(uint8_t *buffer, uint32_t size)
+    : _buf(buffer), _size(size)
+{
+    clear();
+}
+
+void SpiRecorder::clear(void)
+{
+    _head = 0;
+    _tail = 0;
+    _used = 0;
+    _in_record = false;
+    _truncated = false;
+}
+
+void SpiRecorder::write_at(uint32_t pos, uint8_t c)
+{
+    _buf[pos % _size] = c;
+}
+
+void SpiRecorder::drop_oldest(void)
+{
+    uint32_t len = _buf[(_tail + 2) % _size] | (_buf[(_tail + 3) % _size] << 8);
+
+    _tail = (_tail + SPIRECORDER_HEADER_SIZE + len) % _size;
+    _used -= SPIRECORDER_HEADER_SIZE + len;
+}
+
+bool SpiRecorder::make_room(uint32_t len)
+{
+    while ((_size - _used) < len) {
+        /* never drop the record being written */
+        if (_used == 0 || (_in_record && (_tail == _rec_start))) {
+            return false;
+        }
+        drop_oldest();
+    }
+    return true;
+}
+
+void SpiRecorder::begin(uint8_t type)
+{
+    if (!make_room(SPIRECORDER_HEADER_SIZE)) {
+        return;
+    }
+
+    _in_record = true;
+    _truncated = false;
+    _rec_start = _head;
+    _rec_len = 0;
+    _rec_type = type;
+    _rec_time = us_ticker_read();
+    _head = (_head + SPIRECORDER_HEADER_SIZE) % _size;
+    _used += SPIRECORDER_HEADER_SIZE;
+}
+
+void SpiRecorder::put(const void *data, uint32_t len)
+{
+    const uint8_t *ptr = (const uint8_t *)data;
+
+    if (!_in_record) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < len; i++) {
+        if ((_rec_len == 0xFFFF) || !make_room(1)) {
+            _truncated = true;
+            return;
+        }
+        _buf[_head] = ptr[i];
+        _head = (_head + 1) % _size;
+        _used++;
+        _rec_len++;
+    }
+}
+
+void SpiRecorder::end(uint8_t status)
+{
+    if (!_in_record) {
+        return;
+    }
+
+    if (_truncated) {
+        status |= Truncated;
+    }
+    write_at(_rec_start, _rec_type);
+    write_at(_rec_start + 1, status);
+    write_at(_rec_start + 2, _rec_len & 0xFF);
+    write_at(_rec_start + 3, (_rec_len >> 8) & 0xFF);
+    write_at(_rec_start + 4, _rec_time & 0xFF);
+    write_at(_rec_start + 5, (_rec_time >> 8) & 0xFF);
+    write_at(_rec_start + 6, (_rec_time >> 16) & 0xFF);
+    write_at(_rec_start + 7, (_rec_time >> 24) & 0xFF);
+    _in_record = false;
+}
+
+void SpiRecorder::record(uint8_t type, uint8_t status, const void *data, uint32_t len)
+{
+    begin(type);
+    put(data, len);
+    end(status);
+}
+
+uint32_t SpiRecorder::dump(Callback<void(const uint8_t *, uint32_t)> out) const
+{
+    if (_used == 0) {
+        return 0;
+    }
+
+    if (_tail + _used <= _size) {
+        out(&_buf[_tail], _used);
+    } else {
+        out(&_buf[_tail], _size - _tail);
+        out(&_buf[0], _used - (_size - _tail));
+    }
+
+    return _used;
+}
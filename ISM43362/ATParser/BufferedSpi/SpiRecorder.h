@@ -0,0 +1,121 @@
+/**
+ * @file    SpiRecorder.h
+ * @brief   Ring buffer recording of the SPI frames exchanged with the wifi device
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SPIRECORDER_H
+#define SPIRECORDER_H
+
+#include "mbed.h"
+
+/** Size of a record header */
+#define SPIRECORDER_HEADER_SIZE 8
+
+/**
+ *  @class SpiRecorder
+ *  @brief Compact ring buffer of the frames seen by BufferedSpi
+ *
+ *  Each record is a header followed by its payload. The header is, in bytes:
+ *  type, status, payload length (16 bits little endian), timestamp in us
+ *  (32 bits little endian). Once the buffer is full, oldest records are
+ *  dropped.
+ *
+ *  Record types:
+ *  - Tx: payload is the frame sent to the module, padding included
+ *  - Rx: payload is the frame received from the module, as stored in the
+ *        receive buffer
+ *  - ReadyHigh / ReadyRise: wait for data ready to be high before a write,
+ *        or for its rising edge before a read. Payload is the time waited in
+ *        us (32 bits little endian)
+ */
+class SpiRecorder
+{
+public:
+    enum RecordType {
+        Tx = 1,
+        Rx,
+        ReadyHigh,
+        ReadyRise
+    };
+
+    enum RecordStatus {
+        Ok = 0,
+        Timeout,        /**< data ready wait timed out */
+        MissedEdge,     /**< data ready was high at timeout: its rising edge was missed */
+        Overflow,       /**< frame larger than the receive buffer (stuffing forever) */
+        Truncated = 0x80 /**< flag: payload did not fit in the recorder */
+    };
+
+    /** Create a recorder
+     *  @param buffer memory used for the records
+     *  @param size size of buffer
+     */
+    SpiRecorder(uint8_t *buffer, uint32_t size);
+
+    /** Start a record, payload is added with put()
+     *  @param type type of the record
+     */
+    void begin(uint8_t type);
+
+    /** Add payload to the current record
+     *  @param data payload
+     *  @param len size of payload
+     */
+    void put(const void *data, uint32_t len);
+
+    /** End the current record
+     *  @param status status of the record
+     */
+    void end(uint8_t status);
+
+    /** Add a whole record
+     */
+    void record(uint8_t type, uint8_t status, const void *data, uint32_t len);
+
+    /** Export the records, oldest first
+     *
+     *  Must not be called while the module link is in use.
+     *
+     *  @param out function called with consecutive parts of the recording
+     *  @return number of bytes exported
+     */
+    uint32_t dump(Callback<void(const uint8_t *, uint32_t)> out) const;
+
+    /** Drop all records
+     */
+    void clear(void);
+
+private:
+    uint8_t *_buf;
+    uint32_t _size;
+    uint32_t _head;
+    uint32_t _tail;
+    uint32_t _used;
+    bool     _in_record;
+    bool     _truncated;
+    uint32_t _rec_start;
+    uint32_t _rec_len;
+    uint8_t  _rec_type;
+    uint32_t _rec_time;
+
+    bool make_room(uint32_t len);
+    void drop_oldest(void);
+    void write_at(uint32_t pos, uint8_t c);
+};
+#endif
@@ -0,0 +1,160 @@
+/**
+ * @file    SpiReplay.cpp
+ * @brief   Replay of a recorded SPI session with the wifi device
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "SpiReplay.h"
+#include "mbed_debug.h"
+
+// change to true to add few replay debug lines
+#define local_debug false
+
+SpiReplay::SpiReplay(const uint8_t *data, uint32_t size, uint32_t buf_size)
+    : _data(data), _size(size), _pos(0), _rx(NULL), _rx_end(NULL),
+      _buf_size(buf_size), _tx_len(0), _mismatches(0)
+{
+    _txbuf = new char[buf_size];
+}
+
+SpiReplay::~SpiReplay(void)
+{
+    delete[] _txbuf;
+}
+
+bool SpiReplay::next(uint8_t *type, uint8_t *status, const uint8_t **payload, uint32_t *len)
+{
+    if (_pos + SPIRECORDER_HEADER_SIZE > _size) {
+        _pos = _size;
+        return false;
+    }
+
+    *type = _data[_pos];
+    *status = _data[_pos + 1] & ~SpiRecorder::Truncated;
+    *len = _data[_pos + 2] | (_data[_pos + 3] << 8);
+    *payload = &_data[_pos + SPIRECORDER_HEADER_SIZE];
+    if (_pos + SPIRECORDER_HEADER_SIZE + *len > _size) {
+        _pos = _size;
+        return false;
+    }
+    _pos += SPIRECORDER_HEADER_SIZE + *len;
+
+    return true;
+}
+
+int SpiReplay::readable(void)
+{
+    return (_rx != _rx_end) ? 1 : 0;
+}
+
+int SpiReplay::getc(void)
+{
+    if (_rx == _rx_end) {
+        return -1;
+    }
+    return *(_rx++);
+}
+
+int SpiReplay::putc(int c)
+{
+    if (_tx_len < _buf_size) {
+        _txbuf[_tx_len++] = (char)c;
+    }
+    return c;
+}
+
+ssize_t SpiReplay::write_frame(const void *s, size_t length)
+{
+    uint8_t type, status;
+    const uint8_t *payload;
+    uint32_t len;
+
+    while (next(&type, &status, &payload, &len)) {
+        if (type == SpiRecorder::ReadyHigh) {
+            if (status != SpiRecorder::Ok) {
+                return -1;
+            }
+        } else if (type == SpiRecorder::Tx) {
+            /* recorded frame is padded to an even length */
+            if ((len < length) || (memcmp(payload, s, length) != 0)) {
+                debug_if(local_debug, "SpiReplay: frame %d differs from recording\r\n", _pos);
+                _mismatches++;
+            }
+            return length;
+        } else if (type == SpiRecorder::Rx) {
+            /* recorded frame was never read back */
+            _mismatches++;
+        }
+    }
+
+    debug_if(local_debug, "SpiReplay: write past the end of the recording\r\n");
+    _mismatches++;
+    return -1;
+}
+
+ssize_t SpiReplay::buffwrite(const void *s, size_t length)
+{
+    _tx_len = 0;
+    return write_frame(s, length);
+}
+
+ssize_t SpiReplay::buffsend(size_t length)
+{
+    ssize_t ret = write_frame(_txbuf, (length < _tx_len) ? length : _tx_len);
+
+    _tx_len = 0;
+    return (ret < 0) ? ret : length;
+}
+
+ssize_t SpiReplay::read()
+{
+    uint8_t type, status;
+    const uint8_t *payload;
+    uint32_t len;
+
+    while (next(&type, &status, &payload, &len)) {
+        if (type == SpiRecorder::ReadyRise) {
+            if (status != SpiRecorder::Ok) {
+                return -1;
+            }
+        } else if (type == SpiRecorder::Rx) {
+            if (status != SpiRecorder::Ok) {
+                return -1;
+            }
+            _rx = payload;
+            _rx_end = payload + len;
+            return len;
+        } else if (type == SpiRecorder::Tx) {
+            /* recorded frame was never written */
+            _mismatches++;
+        }
+    }
+
+    return -1;
+}
+
+void SpiReplay::setTimeout(int timeout)
+{
+    (void)timeout;
+}
+
+void SpiReplay::setGuard(int guard)
+{
+    (void)guard;
+}
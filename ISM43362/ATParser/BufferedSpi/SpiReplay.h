@@ -0,0 +1,92 @@
+/**
+ * @file    SpiReplay.h
+ * @brief   Replay of a recorded SPI session with the wifi device
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SPIREPLAY_H
+#define SPIREPLAY_H
+
+#include "mbed.h"
+#include "ATTransport.h"
+#include "SpiRecorder.h"
+
+/**
+ *  @class SpiReplay
+ *  @brief Link to the wifi device that plays back a SpiRecorder dump
+ *
+ *  Each read returns the next recorded Rx frame, each write consumes the next
+ *  recorded Tx frame and is compared with it. Waits on the data ready line
+ *  are not replayed, so a session runs as fast as the parser allows and its
+ *  outcome only depends on the recording.
+ *
+ *  Example:
+ *  @code
+ *  ISM43362 wifi(new SpiReplay(recording, recording_size), NC, NC);
+ *  @endcode
+ */
+class SpiReplay : public ATTransport
+{
+public:
+    /** Create a replay link
+     *  @param data recording, as exported by SpiRecorder::dump
+     *  @param size size of the recording
+     *  @param buf_size size of the frames built with putc
+     */
+    SpiReplay(const uint8_t *data, uint32_t size, uint32_t buf_size = 1440 * 4);
+
+    virtual ~SpiReplay(void);
+
+    virtual int readable(void);
+    virtual int getc(void);
+    virtual int putc(int c);
+    virtual ssize_t buffwrite(const void *s, size_t length);
+    virtual ssize_t buffsend(size_t length);
+    virtual ssize_t read();
+    virtual void setTimeout(int timeout);
+    virtual void setGuard(int guard);
+
+    /** Number of written frames that differ from the recording
+     */
+    uint32_t mismatches(void) const
+    {
+        return _mismatches;
+    }
+
+    /** Check if the whole recording was played back
+     */
+    bool done(void) const
+    {
+        return _pos >= _size;
+    }
+
+private:
+    const uint8_t *_data;
+    uint32_t _size;
+    uint32_t _pos;
+    const uint8_t *_rx;
+    const uint8_t *_rx_end;
+    char *_txbuf;
+    uint32_t _buf_size;
+    uint32_t _tx_len;
+    uint32_t _mismatches;
+
+    bool next(uint8_t *type, uint8_t *status, const uint8_t **payload, uint32_t *len);
+    ssize_t write_frame(const void *s, size_t length);
+};
+#endif
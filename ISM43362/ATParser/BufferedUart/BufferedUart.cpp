@@ -0,0 +1,176 @@
+/**
+ * @file    BufferedUart.cpp
+ * @brief   Software Buffer - UART link to the wifi device
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BufferedUart.h"
+#include "mbed_debug.h"
+
+// change to true to add few UART debug lines
+#define local_debug false
+
+// Number of idle character times ending a frame once the prompt is received
+#define BUFFEREDUART_IDLE_CHARS 4
+
+// Flag of _rx_event, set by the receive interrupt on the prompt or when its buffer fills up
+#define BUFFEREDUART_RX_WAKEUP 0x1
+
+// Module prompt, ending the response frames
+static const char prompt[] = "\r\n> ";
+
+BufferedUart::BufferedUart(PinName tx, PinName rx, int baud, uint32_t buf_size)
+    : _serial(tx, rx, baud), _txbuf(buf_size), _irqbuf(buf_size), _rxbuf(buf_size)
+{
+    _buf_size = buf_size;
+    /* 10 bits per character */
+    _idle_us = (BUFFEREDUART_IDLE_CHARS * 10 * 1000000) / baud;
+    _last_rx_us = 0;
+    memset(_irq_tail, 0, sizeof(_irq_tail));
+    setTimeout(0);
+
+    _serial.attach(callback(this, &BufferedUart::rxIrq), RawSerial::RxIrq);
+}
+
+BufferedUart::~BufferedUart(void)
+{
+    _serial.attach(NULL, RawSerial::RxIrq);
+}
+
+void BufferedUart::rxIrq(void)
+{
+    bool wakeup = false;
+
+    while (_serial.readable()) {
+        char c = (char)_serial.getc();
+        _irqbuf = c;
+        memmove(_irq_tail, _irq_tail + 1, sizeof(_irq_tail) - 1);
+        _irq_tail[sizeof(_irq_tail) - 1] = c;
+        wakeup = wakeup || (memcmp(_irq_tail, prompt, sizeof(_irq_tail)) == 0);
+    }
+    _last_rx_us = us_ticker_read();
+
+    /* read() is also woken up before the receive buffer wraps */
+    if (wakeup || (_irqbuf.getNbAvailable() >= _buf_size / 2)) {
+        _rx_event.set(BUFFEREDUART_RX_WAKEUP);
+    }
+}
+
+int BufferedUart::readable(void)
+{
+    return _rxbuf.available();
+}
+
+int BufferedUart::getc(void)
+{
+    if (_rxbuf.available()) {
+        return _rxbuf;
+    }
+    return -1;
+}
+
+int BufferedUart::putc(int c)
+{
+    _txbuf = (char)c;
+
+    return c;
+}
+
+ssize_t BufferedUart::buffwrite(const void *s, size_t length)
+{
+    /* flush buffer from previous message */
+    _txbuf.clear();
+
+    const char *ptr = (const char *)s;
+    for (size_t i = 0; i < length; i++) {
+        _serial.putc(ptr[i]);
+    }
+
+    debug_if(local_debug, "UART Sent %d BYTES\r\n", length);
+    return length;
+}
+
+ssize_t BufferedUart::buffsend(size_t length)
+{
+    /* _txbuffer is already filled with data to send */
+    size_t i = 0;
+    while (_txbuf.available()) {
+        _serial.putc(_txbuf.get());
+        i++;
+    }
+
+    debug_if(local_debug, "UART Sent %d BYTES\r\n", i);
+    return length;
+}
+
+ssize_t BufferedUart::read()
+{
+    /* Tail of the frame, used to find the prompt */
+    char tail[sizeof(prompt) - 1] = {0};
+    uint32_t received = 0;
+    uint32_t len = 0;
+    bool prompt_seen = false;
+    Timer timer;
+    timer.start();
+
+    /* A prompt received from now on wakes the wait below up, the ones
+     * received before are found in _irqbuf */
+    _rx_event.clear(BUFFEREDUART_RX_WAKEUP);
+
+    while (true) {
+        if (_irqbuf.available()) {
+            char c = _irqbuf;
+            /* do not take into account the 2 first \r \n char, as on SPI */
+            if (!((received < 2) && ((c == '\r') || (c == '\n')))) {
+                if (len >= (_buf_size - 1)) {
+                    debug_if(local_debug, "BufferedUart::read overflow\r\n");
+                    return -1;
+                }
+                _rxbuf = c;
+                len++;
+            }
+            received++;
+            memmove(tail, tail + 1, sizeof(tail) - 1);
+            tail[sizeof(tail) - 1] = c;
+            prompt_seen = (memcmp(tail, prompt, sizeof(tail)) == 0);
+            continue;
+        }
+
+        /* Frame is over when the prompt is followed by an idle line */
+        uint32_t idle = us_ticker_read() - _last_rx_us;
+        if (prompt_seen && (idle > _idle_us)) {
+            break;
+        }
+
+        int elapsed = timer.read_ms();
+        if (elapsed > _timeout) {
+            debug_if(local_debug, "BufferedUart::read timeout (%d)\r\n", _timeout);
+            return -1;
+        }
+
+        if (prompt_seen) {
+            /* sleep for the rest of the idle time */
+            wait_us(_idle_us - idle + 1);
+        } else {
+            _rx_event.wait_any(BUFFEREDUART_RX_WAKEUP, _timeout - elapsed + 1);
+        }
+    }
+
+    debug_if(local_debug, "UART READ %d BYTES\r\n", len);
+    return len;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file    BufferedUart.h
+ * @brief   Software Buffer - UART link to the wifi device
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BUFFEREDUART_H
+#define BUFFEREDUART_H
+
+#include "mbed.h"
+#include "MyBuffer.h"
+#include "ATTransport.h"
+
+/**
+ *  @class BufferedUart
+ *  @brief Interrupt driven UART link for the UART variants of the wifi module
+ *
+ *  There is no data ready line on UART: a response frame is complete once
+ *  the module prompt "\r\n> " has been received and the line stays idle.
+ *  The receive interrupt looks for the prompt, so that read() sleeps until
+ *  it comes instead of polling the line.
+ */
+class BufferedUart : public ATTransport
+{
+private:
+    RawSerial     _serial;
+    MyBuffer <char> _txbuf;
+    MyBuffer <char> _irqbuf;
+    MyBuffer <char> _rxbuf;
+    uint32_t      _buf_size;
+    volatile int  _timeout;
+    uint32_t      _idle_us;
+    volatile uint32_t _last_rx_us;
+    char          _irq_tail[4];
+    EventFlags    _rx_event;
+    void rxIrq(void);
+
+public:
+    /** Create a BufferedUart, connected to the specified transmit and receive pins
+     *  @param tx UART transmit pin
+     *  @param rx UART receive pin
+     *  @param baud UART baudrate
+     *  @param buf_size receive buffer size
+     */
+    BufferedUart(PinName tx, PinName rx, int baud = 115200, uint32_t buf_size = 1440);
+
+    /** Destroy a BufferedUart
+     */
+    virtual ~BufferedUart(void);
+
+    /** Check on how many bytes are in the rx buffer
+     *  @return 1 if something exists, 0 otherwise
+     */
+    virtual int readable(void);
+
+    /** Get a single byte of the last read frame
+     *  @return A byte that came in on the UART, -1 if none is left
+     */
+    virtual int getc(void);
+
+    /** Write a single byte to the transmit buffer
+     *  @param c The byte to write
+     *  @return The byte that was written
+     */
+    virtual int putc(int c);
+
+    /** Write data to the UART
+     *  @param s A pointer to data to send
+     *  @param length The amount of data being pointed to
+     *  @return The number of bytes written to the UART
+     */
+    virtual ssize_t buffwrite(const void *s, size_t length);
+
+    /** Send datas to the UART that are already present
+     *  in the internal _txbuffer
+     *  @param length
+     *  @return the number of bytes written on the UART
+     */
+    virtual ssize_t buffsend(size_t length);
+
+    /** Wait for a complete response frame and move it to the _rxbuf
+     *  @return The number of bytes of the frame
+     */
+    virtual ssize_t read();
+
+    /**
+    * Allows timeout to be changed between commands
+    *
+    * @param timeout timeout of the connection
+    */
+    virtual void setTimeout(int timeout)
+    {
+        /*  same safe guard margin as BufferedSpi, the module timeout
+         *  applies to the response, not to the link */
+        _timeout = timeout + ATTRANSPORT_GUARD_MARGIN;
+    }
+
+    virtual void setGuard(int guard)
+    {
+        _timeout = guard;
+    }
+};
+#endif
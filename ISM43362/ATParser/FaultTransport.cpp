@@ -0,0 +1,240 @@
+/* Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * Fault injection between the AT parser and the link to the module
+ *
+ */
+
+#include <string.h>
+#include "FaultTransport.h"
+#include "mbed_debug.h"
+
+// change to true to log the injected faults
+#define local_debug false
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+#define MAX(a,b) (((a)>(b))?(a):(b))
+
+static const char fault_error[] = "ERROR\r\n> ";
+static const char fault_ok[] = "OK\r\n> ";
+static const char fault_empty_read[] = "\r\n\r\nOK\r\n> ";
+
+FaultTransport::FaultTransport(uint32_t buf_size)
+    : _inner(NULL), _buf_size(buf_size), _rx_len(0), _rx_pos(0), _tx_len(0)
+{
+    memset(_command, 0, sizeof(_command));
+    _rxbuf = new char[buf_size];
+    _txbuf = new char[4 * buf_size];
+    memset(_faults, 0, sizeof(_faults));
+    seed(1);
+    reset_stats();
+}
+
+FaultTransport::~FaultTransport(void)
+{
+    delete[] _rxbuf;
+    delete[] _txbuf;
+}
+
+void FaultTransport::wrap(ATTransport *inner)
+{
+    _inner = inner;
+}
+
+void FaultTransport::set_fault(Fault fault, uint16_t per_mille, uint32_t param)
+{
+    _faults[fault].per_mille = per_mille;
+    _faults[fault].param = param;
+}
+
+void FaultTransport::seed(uint32_t seed)
+{
+    _random = seed ? seed : 1;
+}
+
+void FaultTransport::get_stats(Stats *stats)
+{
+    *stats = _stats;
+}
+
+void FaultTransport::reset_stats(void)
+{
+    memset(&_stats, 0, sizeof(_stats));
+    _recovering = false;
+}
+
+/* xorshift32 */
+uint32_t FaultTransport::random(void)
+{
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    return _random;
+}
+
+bool FaultTransport::inject(Fault fault)
+{
+    if ((_faults[fault].per_mille == 0) || ((random() % 1000) >= _faults[fault].per_mille)) {
+        return false;
+    }
+
+    debug_if(local_debug, "FaultTransport: inject fault %d\r\n", fault);
+    _stats.injected[fault]++;
+    if (!_recovering) {
+        _recovering = true;
+        _fault_time = us_ticker_read();
+    }
+    return true;
+}
+
+/* Keep the start of the last command, to know what its response says */
+void FaultTransport::command(const char *s, size_t length)
+{
+    memset(_command, 0, sizeof(_command));
+    memcpy(_command, s, MIN(length, sizeof(_command)));
+}
+
+/* A socket works again once one is opened, or once data is read from one */
+bool FaultTransport::socket_works(void)
+{
+    if ((memcmp(_command, "P5=1", 4) == 0) || (memcmp(_command, "P6=1", 4) == 0)) {
+        return true;
+    }
+    return (memcmp(_command, "R0", 2) == 0) && (_rx_len > sizeof(fault_empty_read) - 1);
+}
+
+int FaultTransport::readable(void)
+{
+    return (_rx_pos < _rx_len) ? 1 : 0;
+}
+
+int FaultTransport::getc(void)
+{
+    if (_rx_pos >= _rx_len) {
+        return -1;
+    }
+    return _rxbuf[_rx_pos++];
+}
+
+int FaultTransport::putc(int c)
+{
+    if (_tx_len < (4 * _buf_size)) {
+        _txbuf[_tx_len++] = (char)c;
+    }
+    return c;
+}
+
+ssize_t FaultTransport::buffwrite(const void *s, size_t length)
+{
+    _tx_len = 0;
+    command((const char *)s, length);
+    if (inject(FailWrite)) {
+        return -1;
+    }
+    return _inner->buffwrite(s, length);
+}
+
+ssize_t FaultTransport::buffsend(size_t length)
+{
+    uint32_t len = _tx_len;
+
+    _tx_len = 0;
+    command(_txbuf, len);
+    if (inject(FailWrite)) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        _inner->putc(_txbuf[i]);
+    }
+    return _inner->buffsend(length);
+}
+
+ssize_t FaultTransport::read()
+{
+    bool faulty = false;
+
+    _rx_len = 0;
+    _rx_pos = 0;
+
+    if (inject(DelayReady)) {
+        wait_ms(_faults[DelayReady].param);
+    }
+
+    ssize_t ret = _inner->read();
+    if (ret < 0) {
+        return ret;
+    }
+
+    while (_inner->readable() && (_rx_len < _buf_size)) {
+        _rxbuf[_rx_len++] = _inner->getc();
+    }
+    while (_inner->readable()) {
+        _inner->getc();
+    }
+
+    if (inject(DropFrame)) {
+        _rx_len = 0;
+        return -1;
+    }
+
+    if (inject(Error)) {
+        faulty = true;
+        _rx_len = MIN(sizeof(fault_error) - 1, _buf_size);
+        memcpy(_rxbuf, fault_error, _rx_len);
+    } else if ((_rx_len > 0) && inject(Truncate)) {
+        faulty = true;
+        _rx_len = random() % _rx_len;
+    }
+
+    if (inject(Stuffing)) {
+        uint32_t count = MIN(_faults[Stuffing].param, _buf_size - _rx_len);
+        uint32_t at = random() % (_rx_len + 1);
+
+        faulty = true;
+        memmove(&_rxbuf[at + count], &_rxbuf[at], _rx_len - at);
+        memset(&_rxbuf[at], 0x15, count);
+        _rx_len += count;
+    }
+
+    /* back to a working link once a clean response ending with OK shows a
+     * working socket */
+    if (_recovering && !faulty && (_rx_len >= sizeof(fault_ok) - 1)
+            && (memcmp(&_rxbuf[_rx_len - (sizeof(fault_ok) - 1)], fault_ok, sizeof(fault_ok) - 1) == 0)
+            && socket_works()) {
+        uint32_t elapsed = (us_ticker_read() - _fault_time) / 1000;
+        _recovering = false;
+        _stats.recoveries++;
+        _stats.recovery_total_ms += elapsed;
+        _stats.recovery_max_ms = MAX(_stats.recovery_max_ms, elapsed);
+    }
+
+    return _rx_len;
+}
+
+void FaultTransport::setTimeout(int timeout)
+{
+    _inner->setTimeout(timeout);
+}
+
+void FaultTransport::setGuard(int guard)
+{
+    _inner->setGuard(guard);
+}
+
+uint32_t FaultTransport::wait_time(void)
+{
+    return _inner->wait_time();
+}
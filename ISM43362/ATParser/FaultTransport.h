@@ -0,0 +1,139 @@
+/* Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * Fault injection between the AT parser and the link to the module
+ *
+ */
+
+#ifndef FAULT_TRANSPORT_H
+#define FAULT_TRANSPORT_H
+
+#include "mbed.h"
+#include "ATTransport.h"
+
+/**
+ * Link to the module that randomly corrupts the frames of another one
+ *
+ * Faults are drawn from a seeded pseudo random generator, so a given seed
+ * and sequence of commands always injects the same faults. The recovery
+ * time is measured from the first fault until a socket works again: a
+ * socket opened (P5=1, P6=1) or data read (R0) by a response ending with OK
+ * that was not itself corrupted.
+ *
+ * Example:
+ * @code
+ * FaultTransport faults;
+ * faults.set_fault(FaultTransport::DropFrame, 10);    // 1% of the responses
+ * faults.set_fault(FaultTransport::Stuffing, 10, 4);  // 1%, 4 bytes of 0x15
+ * wifi.set_fault_injection(&faults);
+ * @endcode
+ */
+class FaultTransport : public ATTransport
+{
+public:
+    enum Fault {
+        DropFrame = 0,  /*!< response lost, read fails */
+        DelayReady,     /*!< response delayed by param milliseconds */
+        Stuffing,       /*!< param 0x15 padding bytes inserted in the response */
+        Truncate,       /*!< response cut at a random length */
+        Error,          /*!< response replaced by ERROR */
+        FailWrite,      /*!< command not sent, write fails */
+
+        FaultCount
+    };
+
+    /** Statistics of the injected faults and of the recoveries from them
+     */
+    typedef struct {
+        uint32_t injected[FaultCount];  /*!< faults injected, indexed by Fault */
+        uint32_t recoveries;            /*!< returns to a working socket after faults */
+        uint32_t recovery_total_ms;     /*!< sum of the recovery times */
+        uint32_t recovery_max_ms;       /*!< longest recovery time */
+    } Stats;
+
+    /** Create a fault injection link, to be installed with ISM43362::set_fault_injection
+     *
+     * @param buf_size size of the largest response
+     */
+    FaultTransport(uint32_t buf_size = 1440);
+
+    virtual ~FaultTransport(void);
+
+    /** Set the link the faults are injected into
+     *
+     * @param inner link to the module
+     */
+    void wrap(ATTransport *inner);
+
+    /** Configure a fault
+     *
+     * @param fault type of the fault
+     * @param per_mille probability of the fault for each frame, in 1/1000, 0 to disable
+     * @param param delay in ms for DelayReady, number of bytes for Stuffing
+     */
+    void set_fault(Fault fault, uint16_t per_mille, uint32_t param = 1);
+
+    /** Restart the fault sequence
+     *
+     * @param seed seed of the pseudo random generator, not 0
+     */
+    void seed(uint32_t seed);
+
+    /** Get the fault and recovery statistics
+     *
+     * @param stats destination for the statistics
+     */
+    void get_stats(Stats *stats);
+
+    /** Clear the fault and recovery statistics
+     */
+    void reset_stats(void);
+
+    virtual int readable(void);
+    virtual int getc(void);
+    virtual int putc(int c);
+    virtual ssize_t buffwrite(const void *s, size_t length);
+    virtual ssize_t buffsend(size_t length);
+    virtual ssize_t read();
+    virtual void setTimeout(int timeout);
+    virtual void setGuard(int guard);
+    virtual uint32_t wait_time(void);
+
+private:
+    ATTransport *_inner;
+    char *_rxbuf;
+    uint32_t _buf_size;
+    uint32_t _rx_len;
+    uint32_t _rx_pos;
+    char *_txbuf;
+    uint32_t _tx_len;
+    uint32_t _random;
+    struct {
+        uint16_t per_mille;
+        uint32_t param;
+    } _faults[FaultCount];
+    Stats _stats;
+    bool _recovering;
+    uint32_t _fault_time;
+    char _command[4];
+
+    uint32_t random(void);
+    bool inject(Fault fault);
+    void command(const char *s, size_t length);
+    bool socket_works(void);
+};
+
+#endif
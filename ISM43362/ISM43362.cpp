@@ -16,19 +16,24 @@
  */
 #include <string.h>
 #include "ISM43362.h"
+#include "BufferedSpi.h"
+#include "BufferedUart.h"
+#include "FaultTransport.h"
 #include "mbed_debug.h"
+#include "ATTrace.h"
 
 // ao activate  / de-activate debug
 #define ism_debug false
 
 ISM43362::ISM43362(PinName mosi, PinName miso, PinName sclk, PinName nss, PinName resetpin, PinName datareadypin, PinName wakeup, bool debug)
-    : _bufferspi(mosi, miso, sclk, nss, datareadypin), _parser(_bufferspi), _resetpin(resetpin),
+    : _transport(new BufferedSpi(mosi, miso, sclk, nss, datareadypin)), _parser(*_transport), _resetpin(resetpin),
       _packets(0), _packets_end(&_packets)
 {
     DigitalOut wakeup_pin(wakeup);
+    _spi = static_cast<BufferedSpi *>(_transport);
     ISM43362::setTimeout((uint32_t)5000);
-    _bufferspi.format(16, 0); /* 16bits, ploarity low, phase 1Edge, master mode */
-    _bufferspi.frequency(10000000); /* up to 20 MHz */
+    _spi->format(16, 0); /* 16bits, ploarity low, phase 1Edge, master mode */
+    _spi->frequency(10000000); /* up to 20 MHz */
     _active_id = 0xFF;
 
     reset();
@@ -36,6 +41,37 @@ ISM43362::ISM43362(PinName mosi, PinName miso, PinName sclk, PinName nss, PinNam
     _parser.debugOn(debug);
 }
 
+ISM43362::ISM43362(PinName tx, PinName rx, PinName resetpin, PinName wakeup, bool debug, int baud)
+    : _transport(new BufferedUart(tx, rx, baud)), _spi(NULL), _parser(*_transport), _resetpin(resetpin),
+      _packets(0), _packets_end(&_packets)
+{
+    DigitalOut wakeup_pin(wakeup);
+    ISM43362::setTimeout((uint32_t)5000);
+    _active_id = 0xFF;
+
+    reset();
+
+    _parser.debugOn(debug);
+}
+
+ISM43362::ISM43362(ATTransport *transport, PinName resetpin, PinName wakeup, bool debug)
+    : _transport(transport), _spi(NULL), _parser(*_transport), _resetpin(resetpin),
+      _packets(0), _packets_end(&_packets)
+{
+    DigitalOut wakeup_pin(wakeup);
+    ISM43362::setTimeout((uint32_t)5000);
+    _active_id = 0xFF;
+
+    reset();
+
+    _parser.debugOn(debug);
+}
+
+ISM43362::~ISM43362()
+{
+    delete _transport;
+}
+
 /**
   * @brief  Parses and returns number from string.
   * @param  ptr: pointer to string
@@ -49,6 +85,18 @@ ISM43362::ISM43362(PinName mosi, PinName miso, PinName sclk, PinName nss, PinNam
 #define CHAR2NUM(x)                     ((x) - '0')
 
 
+/**
+  * @brief  Copy a field of a module response, bounded and null-terminated.
+  * @param  dest: destination buffer
+  * @param  src: null-terminated field
+  * @param  size: size of the destination buffer
+  */
+static void CopyField(char *dest, const char *src, size_t size)
+{
+    strncpy(dest, src, size - 1);
+    dest[size - 1] = 0;
+}
+
 extern "C" int32_t ParseNumber(char* ptr, uint8_t* cnt) 
 {
     uint8_t minus = 0, i = 0;
@@ -62,10 +110,14 @@ extern "C" int32_t ParseNumber(char* ptr, uint8_t* cnt)
     while (CHARISNUM(*ptr) || (*ptr=='.')) {   /* Parse number */
         if (*ptr == '.') {
             ptr++; // next char
-        } else {
+        } else if (sum <= (INT32_MAX - 9) / 10) {
             sum = 10 * sum + CHAR2NUM(*ptr);
             ptr++;
             i++;
+        } else {
+            sum = INT32_MAX;                                    /* Saturate too long numbers */
+            ptr++;
+            i++;
         }
     }
 
@@ -80,10 +132,10 @@ extern "C" int32_t ParseNumber(char* ptr, uint8_t* cnt)
 
 const char *ISM43362::get_firmware_version(void)
 {
-    char tmp_buffer[250];
-    char *ptr, *ptr2;
+    char tmp_buffer[250] = {0};
+    char *ptr;
 
-    if(!(_parser.send("I?") && _parser.recv("%s\r\n", tmp_buffer) && check_response())) {
+    if(!(_parser.send("I?") && _parser.recv("%249s\r\n", tmp_buffer) && check_response())) {
         debug_if(ism_debug, "get_firmware_version is FAIL\r\n");
         return 0;
     }
@@ -91,12 +143,11 @@ const char *ISM43362::get_firmware_version(void)
     // Get the first version in the string
     ptr = strtok((char *)tmp_buffer, ",");
     ptr = strtok(NULL, ",");
-    ptr2 = strtok(NULL, ",");
     if (ptr == NULL) {
         debug_if(ism_debug, "get_firmware_version decoding is FAIL\r\n");
         return 0;
     }
-    strncpy(_fw_version, ptr , ptr2-ptr);
+    CopyField(_fw_version, ptr, sizeof(_fw_version));
 
     debug_if(ism_debug, "get_firmware_version = [%s]\r\n", _fw_version);
 
@@ -106,6 +157,14 @@ const char *ISM43362::get_firmware_version(void)
 bool ISM43362::reset(void)
 {
     debug_if(ism_debug,"Reset Module\r\n");
+    /* Anything received before the reset is meaningless */
+    _parser.flush();
+    memset(_rx_packet_size, 0, sizeof(_rx_packet_size));
+    memset(_rx_timeout, 0, sizeof(_rx_timeout));
+    memset(_tx_timeout, 0, sizeof(_tx_timeout));
+    /* The module forgets the selected socket, P0 must be sent again */
+    _active_id = 0xFF;
+    _accepted_count = 0;
     _resetpin = 0;
     wait_ms(10);
     _resetpin = 1;
@@ -179,6 +238,7 @@ bool ISM43362::dhcp(bool enabled)
 
 bool ISM43362::connect(const char *ap, const char *passPhrase)
 {
+    ATTRACE_SCOPE("ism_connect");
     if (!(_parser.send("C1=%s", ap) && check_response())) {
         return false;
     }
@@ -207,11 +267,11 @@ bool ISM43362::disconnect(void)
 
 const char *ISM43362::getIPAddress(void)
 {
-    char tmp_ip_buffer[250];
-    char *ptr, *ptr2;
+    char tmp_ip_buffer[250] = {0};
+    char *ptr;
 
     if(!(_parser.send("C?")
-                && _parser.recv("%s\r\n", tmp_ip_buffer) && check_response())) {
+                && _parser.recv("%249s\r\n", tmp_ip_buffer) && check_response())) {
         debug_if(ism_debug,"getIPAddress LINE KO: %s", tmp_ip_buffer);
         return 0;
     }
@@ -224,11 +284,9 @@ const char *ISM43362::getIPAddress(void)
     ptr = strtok(NULL, ",");
     ptr = strtok(NULL, ",");
     ptr = strtok(NULL, ",");
-    ptr2 = strtok(NULL, ",");
     if (ptr == NULL) return 0;
-    strncpy(_ip_buffer, ptr , ptr2-ptr);
+    CopyField(_ip_buffer, ptr, sizeof(_ip_buffer));
 
-    tmp_ip_buffer[59] = 0;
     debug_if(ism_debug,"receivedIPAddress: %s\n", _ip_buffer);
 
     return _ip_buffer;
@@ -236,7 +294,7 @@ const char *ISM43362::getIPAddress(void)
 
 const char *ISM43362::getMACAddress(void)
 {
-    if(!(_parser.send("Z5") && _parser.recv("%s\r\n", _mac_buffer) && check_response())) {
+    if(!(_parser.send("Z5") && _parser.recv("%17s\r\n", _mac_buffer) && check_response())) {
         debug_if(ism_debug,"receivedMacAddress LINE KO: %s", _mac_buffer);
         return 0;
     }
@@ -248,9 +306,9 @@ const char *ISM43362::getMACAddress(void)
 
 const char *ISM43362::getGateway()
 {
-    char tmp[250];
+    char tmp[250] = {0};
 
-    if(!(_parser.send("C?") && _parser.recv("%s\r\n", tmp) && check_response())) {
+    if(!(_parser.send("C?") && _parser.recv("%249s\r\n", tmp) && check_response())) {
         debug_if(ism_debug,"getGateway LINE KO: %s\r\n", tmp);
         return 0;
     }
@@ -263,7 +321,10 @@ const char *ISM43362::getGateway()
          ptr = strtok(NULL,",");
     }
 
-    strncpy(_gateway_buffer, ptr, sizeof(_gateway_buffer));
+    if (ptr == NULL) {
+        return 0;
+    }
+    CopyField(_gateway_buffer, ptr, sizeof(_gateway_buffer));
 
     debug_if(ism_debug,"getGateway: %s\r\n", _gateway_buffer);
 
@@ -272,9 +333,9 @@ const char *ISM43362::getGateway()
 
 const char *ISM43362::getNetmask()
 {
-    char tmp[250];
+    char tmp[250] = {0};
 
-    if(!(_parser.send("C?") && _parser.recv("%s\r\n", tmp) && check_response())) {
+    if(!(_parser.send("C?") && _parser.recv("%249s\r\n", tmp) && check_response())) {
         debug_if(ism_debug,"getNetmask LINE KO: %s", tmp);
         return 0;
     }
@@ -287,7 +348,10 @@ const char *ISM43362::getNetmask()
          ptr = strtok(NULL,",");
     }
 
-    strncpy(_netmask_buffer, ptr, sizeof(_netmask_buffer));
+    if (ptr == NULL) {
+        return 0;
+    }
+    CopyField(_netmask_buffer, ptr, sizeof(_netmask_buffer));
 
     debug_if(ism_debug,"getNetmask: %s\r\n", _netmask_buffer);
 
@@ -297,18 +361,29 @@ const char *ISM43362::getNetmask()
 int8_t ISM43362::getRSSI()
 {
     int8_t rssi;
-    char tmp[25];
 
-    if(!(_parser.send("CR") && _parser.recv("%s\r\n", tmp) && check_response())) {
-        debug_if(ism_debug,"getRSSI LINE KO: %s\r\n", tmp);
+    if (!getRSSI(rssi)) {
         return 0;
     }
 
+    return rssi;
+}
+
+bool ISM43362::getRSSI(int8_t &rssi)
+{
+    ATTRACE_SCOPE("ism_rssi");
+    char tmp[25] = {0};
+
+    if(!(_parser.send("CR") && _parser.recv("%24s\r\n", tmp) && check_response())) {
+        debug_if(ism_debug,"getRSSI LINE KO: %s\r\n", tmp);
+        return false;
+    }
+
     rssi = ParseNumber(tmp, NULL);
 
     debug_if(ism_debug,"getRSSI: %d\r\n", rssi);
 
-    return rssi;
+    return true;
 }
 /**
   * @brief  Parses Security type.
@@ -317,13 +392,14 @@ int8_t ISM43362::getRSSI()
   */
 extern "C" nsapi_security_t ParseSecurity(char* ptr) 
 {
+  /* Longest names first, "WPA" is a substring of all WPA2 variants */
   if(strstr(ptr,"Open")) return NSAPI_SECURITY_NONE;
   else if(strstr(ptr,"WEP")) return NSAPI_SECURITY_WEP;
-  else if(strstr(ptr,"WPA")) return NSAPI_SECURITY_WPA;   
-  else if(strstr(ptr,"WPA2 AES")) return NSAPI_SECURITY_WPA2; 
-  else if(strstr(ptr,"WPA WPA2")) return NSAPI_SECURITY_WPA_WPA2; 
-  else if(strstr(ptr,"WPA2 TKIP")) return NSAPI_SECURITY_UNKNOWN; // ?? no match in mbed ?   
-  else return NSAPI_SECURITY_UNKNOWN;           
+  else if(strstr(ptr,"WPA WPA2")) return NSAPI_SECURITY_WPA_WPA2;
+  else if(strstr(ptr,"WPA2 AES")) return NSAPI_SECURITY_WPA2;
+  else if(strstr(ptr,"WPA2 TKIP")) return NSAPI_SECURITY_UNKNOWN; // ?? no match in mbed ?
+  else if(strstr(ptr,"WPA")) return NSAPI_SECURITY_WPA;
+  else return NSAPI_SECURITY_UNKNOWN;
 }
 
 /**
@@ -375,6 +451,7 @@ bool ISM43362::isConnected(void)
 
 int ISM43362::scan(WiFiAccessPoint *res, unsigned limit)
 {
+    ATTRACE_SCOPE("ism_scan");
     unsigned cnt = 0, num=0;
     nsapi_wifi_ap_t ap;
     char *ptr;
@@ -386,7 +463,7 @@ int ISM43362::scan(WiFiAccessPoint *res, unsigned limit)
     }
 
     /* Parse the received buffer and fill AP buffer */
-    while (_parser.recv("#%s\n", tmp)) {
+    while (_parser.recv("#%255s\n", tmp)) {
         debug_if(ism_debug,"received:%s", tmp);
         ptr = strtok(tmp, ",");
         num = 0;
@@ -402,12 +479,17 @@ int ISM43362::scan(WiFiAccessPoint *res, unsigned limit)
             case 7: /* Ignore Radio Band */
                 break;
             case 1:
+                /* SSID is quoted */
                 ptr[strlen(ptr) - 1] = 0;
-                strncpy((char *)ap.ssid,  ptr+ 1, 32);
+                CopyField((char *)ap.ssid, ptr + 1, sizeof(ap.ssid));
                 break;
             case 2:
-                for (int i=0; i<6; i++) {
-                    ap.bssid[i] = ParseHexNumber(ptr + (i*3), NULL);
+                /* BSSID is xx:xx:xx:xx:xx:xx */
+                memset(ap.bssid, 0, sizeof(ap.bssid));
+                if (strlen(ptr) >= 17) {
+                    for (int i=0; i<6; i++) {
+                        ap.bssid[i] = ParseHexNumber(ptr + (i*3), NULL);
+                    }
                 }
                 break;
             case 3:
@@ -418,7 +500,9 @@ int ISM43362::scan(WiFiAccessPoint *res, unsigned limit)
                 break;
             case 8:
                 ap.channel = ParseNumber(ptr, NULL);
-                res[cnt] = WiFiAccessPoint(ap);
+                if (limit != 0) {
+                    res[cnt] = WiFiAccessPoint(ap);
+                }
                 cnt++;
                 num = 1;
                 break;
@@ -439,8 +523,34 @@ int ISM43362::scan(WiFiAccessPoint *res, unsigned limit)
 
 }
 
+bool ISM43362::getBSSID(uint8_t bssid[6])
+{
+    char tmp[250] = {0};
+    char *ptr;
+
+    if(!(_parser.send("C?") && _parser.recv("%249s\r\n", tmp) && check_response())) {
+        debug_if(ism_debug,"getBSSID LINE KO: %s\r\n", tmp);
+        return false;
+    }
+
+    /* The BSSID is the xx:xx:xx:xx:xx:xx field of the settings, the SSID
+     * comes first so that it is not taken for it */
+    ptr = strtok(tmp, ",");
+    while ((ptr = strtok(NULL, ",")) != NULL) {
+        if ((strlen(ptr) == 17) && (ptr[2] == ':') && (ptr[14] == ':')) {
+            for (int i = 0; i < 6; i++) {
+                bssid[i] = ParseHexNumber(ptr + (i * 3), NULL);
+            }
+            return true;
+        }
+    }
+
+    return false;
+}
+
 bool ISM43362::open(const char *type, int id, const char* addr, int port)
-{ /* TODO : This is the implementation for the client socket, need to check if need to create openserver too */
+{ /* This is the implementation for the client socket, see open_server for server side */
+    ATTRACE_SCOPE("ism_open");
     //IDs only 0-3
     if((id < 0) ||(id > 3)) {
         debug_if(ism_debug, "open: wrong id\n");
@@ -470,23 +580,212 @@ bool ISM43362::open(const char *type, int id, const char* addr, int port)
 
     /* request as much data as possible - i.e. module max size */
     if (!(_parser.send("R1=%d", ES_WIFI_MAX_RX_PACKET_SIZE)&& check_response())) {
-            return -1;
+            return false;
+    }
+    _rx_packet_size[id] = ES_WIFI_MAX_RX_PACKET_SIZE;
+    _rx_timeout[id] = 0;
+    _tx_timeout[id] = 0;
+
+    return true;
+}
+
+bool ISM43362::set_certificate(int type, const char *data, uint32_t len)
+{
+    if ((type < 0) || (type > 2) || (len > ES_WIFI_MAX_CERT_SIZE)) {
+        return false;
+    }
+    debug_if(ism_debug, "SET certificate type %d, len %d\n", type, len);
+
+    /* Certificate is sent in the same frame as the command, like for S3:
+     * PG=<credential set>,<type>,<length> */
+    int i = _parser.printf("PG=%d,%d,%d\r", ES_WIFI_CERT_SET, type, (int)len);
+    if (i < 0) {
+        return false;
+    }
+    i = _parser.write(data, len, i);
+    if (i < 0) {
+        return false;
     }
 
+    return check_response();
+}
+
+bool ISM43362::record(SpiRecorder *recorder)
+{
+    if (_spi == NULL) {
+        return false;
+    }
+
+    _spi->record(recorder);
+    return true;
+}
+
+void ISM43362::set_fault_injection(FaultTransport *faults)
+{
+    if (faults) {
+        faults->wrap(_transport);
+        _parser.setTransport(*faults);
+    } else {
+        _parser.setTransport(*_transport);
+    }
+}
+
+bool ISM43362::open_server(const char *type, int id, int port)
+{
+    //IDs only 0-3
+    if((id < 0) ||(id > 3)) {
+        debug_if(ism_debug, "open_server: wrong id\n");
+        return false;
+    }
+    debug_if(ism_debug, "OPEN server socket\n");
+    _active_id = id;
+    if (!(_parser.send("P0=%d", id) && check_response())) {
+        return false;
+    }
+    /* Set protocol */
+    if (!(_parser.send("P1=%s", type) && check_response())) {
+        return false;
+    }
+    /* Set local port */
+    if (!(_parser.send("P2=%d", port) && check_response())) {
+        return false;
+    }
+    /* Start server */
+    if (!(_parser.send("P5=1") && check_response())) {
+        return false;
+    }
+
+    /* request as much data as possible - i.e. module max size */
+    if (!(_parser.send("R1=%d", ES_WIFI_MAX_RX_PACKET_SIZE)&& check_response())) {
+        return false;
+    }
+    _rx_packet_size[id] = ES_WIFI_MAX_RX_PACKET_SIZE;
+    _rx_timeout[id] = 0;
+    _tx_timeout[id] = 0;
+
+    return true;
+}
+
+int ISM43362::accept(int id, char *ip, int *port)
+{
+    ATTRACE_SCOPE("ism_accept");
+
+    if ((id < 0) ||(id > 3)) {
+        return -1;
+    }
+
+    int server;
+    int client;
+    struct accepted remote;
+    if (!transport_status(id, &server, &client, &remote)) {
+        return -1;
+    }
+    if (!client) {
+        return 0;
+    }
+
+    /* The messages are shared by the servers: the one of the peer of this
+     * socket is taken, or else the oldest one, the others are kept */
+    if (!read_messages()) {
+        return -1;
+    }
+    int i;
+    for (i = 0; i < _accepted_count; i++) {
+        if ((strcmp(_accepted[i].ip, remote.ip) == 0) && (_accepted[i].port == remote.port)) {
+            break;
+        }
+    }
+    if (i == _accepted_count) {
+        i = 0;
+    }
+    if (_accepted_count == 0) {
+        /* The connection is up, its message was lost */
+        strcpy(ip, "0.0.0.0");
+        *port = 0;
+    } else {
+        strcpy(ip, _accepted[i].ip);
+        *port = _accepted[i].port;
+        _accepted_count--;
+        memmove(&_accepted[i], &_accepted[i + 1], (_accepted_count - i) * sizeof(_accepted[0]));
+    }
+
+    debug_if(ism_debug, "accept: client %s:%d\r\n", ip, *port);
+    return 1;
+}
+
+/*  Read the pending module messages, keeping the accepted connections.
+ *  A connection shows up as: [SOMA]Accepted <ip>:<port>[EOMA]
+ *  The line has a space, so the frame is read as is rather than parsed */
+bool ISM43362::read_messages(void)
+{
+    char tmp[256];
+    char *ptr;
+
+    if (!_parser.send("MR")) {
+        return false;
+    }
+    int len = _parser.read(tmp, sizeof(tmp) - 1);
+    if (len < 0) {
+        debug_if(ism_debug, "read_messages LINE KO\r\n");
+        return false;
+    }
+    tmp[len] = 0;
+    if (strstr(tmp, "\r\nOK\r\n> ") == NULL) {
+        debug_if(ism_debug, "read_messages LINE KO: %s\r\n", tmp);
+        return false;
+    }
+
+    ptr = tmp;
+    while ((ptr = strstr(ptr, "Accepted ")) != NULL) {
+        ptr += strlen("Accepted ");
+        char *sep = strchr(ptr, ':');
+        if (sep == NULL) {
+            break;
+        }
+        if (_accepted_count == ES_WIFI_ACCEPT_QUEUE_SIZE) {
+            debug_if(ism_debug, "read_messages: accept queue full\r\n");
+            break;
+        }
+        struct accepted *a = &_accepted[_accepted_count++];
+        *sep = 0;
+        strncpy(a->ip, ptr, sizeof(a->ip));
+        a->ip[sizeof(a->ip) - 1] = 0;
+        a->port = ParseNumber(sep + 1, NULL);
+        ptr = sep + 1;
+    }
+    return true;
+}
+
+bool ISM43362::close_server(int id)
+{
+    if ((id <0) || (id > 3)) {
+        debug_if(ism_debug,"Wrong socket number\n");
+        return false;
+    }
+    debug_if(ism_debug,"CLOSE server socket id=%d\n", id);
+    _active_id = id;
+    if (!(_parser.send("P0=%d", id) && check_response())) {
+        return false;
+    }
+    /* stop server on this socket */
+    if (!(_parser.send("P5=0") && check_response())) {
+        return false;
+    }
     return true;
 }
 
 bool ISM43362::dns_lookup(const char* name, char* ip)
 {
-    char tmp[30];
+    ATTRACE_SCOPE("ism_dns");
+    char tmp[30] = {0};
 
-    if (!(_parser.send("D0=%s", name) && _parser.recv("%s\r\n", tmp)
+    if (!(_parser.send("D0=%s", name) && _parser.recv("%29s\r\n", tmp)
                 && check_response())) {
         debug_if(ism_debug,"dns_lookup LINE KO: %s", tmp);
         return 0;
     }
 
-    strncpy(ip, tmp, sizeof(tmp));
+    CopyField(ip, tmp, NSAPI_IP_SIZE);
 
     debug_if(ism_debug, "ip of DNSlookup: %s\n", ip);
     return 1;
@@ -494,6 +793,7 @@ bool ISM43362::dns_lookup(const char* name, char* ip)
 
 bool ISM43362::send(int id, const void *data, uint32_t amount)
 {
+    ATTRACE_SCOPE("ism_send");
     // The Size limit has to be checked on caller side.
     if (amount > ES_WIFI_MAX_RX_PACKET_SIZE) {
         return false;
@@ -512,8 +812,11 @@ bool ISM43362::send(int id, const void *data, uint32_t amount)
     }
 
     /* Change the write timeout */
-    if (!(_parser.send("S2=%d", _timeout) && check_response())) {
-        return false;
+    if (_tx_timeout[id] != _timeout) {
+        if (!(_parser.send("S2=%d", _timeout) && check_response())) {
+            return false;
+        }
+        _tx_timeout[id] = _timeout;
     }
     /* set Write Transport Packet Size */
     int i = _parser.printf("S3=%d\r", (int)amount);
@@ -532,10 +835,82 @@ bool ISM43362::send(int id, const void *data, uint32_t amount)
     return true;
 }
 
-int ISM43362::check_recv_status(int id, void *data)
+int ISM43362::socket_status(int id)
+{
+    ATTRACE_SCOPE("ism_status");
+    int server;
+    int client;
+
+    if ((id < 0) || (id > 3)) {
+        return -1;
+    }
+    if (!transport_status(id, &server, &client)) {
+        return -1;
+    }
+    /* A server keeps running once its client is gone */
+    return client ? 1 : 0;
+}
+
+/*  Read the server and client running flags of a socket, and the address
+ *  of its peer if remote is set */
+bool ISM43362::transport_status(int id, int *server, int *client, struct accepted *remote)
+{
+    char tmp[128] = {0};
+    char *field[9];
+
+    if (_active_id != id) {
+        _active_id = id;
+        if (!(_parser.send("P0=%d", id) && check_response())) {
+            return false;
+        }
+    }
+
+    /* The transport settings of the socket are reported as:
+     * <protocol>,<local ip>,<local port>,<remote ip>,<remote port>,
+     * <server timeout>,<backlog>,<server running>,<client running>,... */
+    if (!(_parser.send("P?") && _parser.recv("%127s\r\n", tmp) && check_response())) {
+        debug_if(ism_debug, "transport_status LINE KO\r\n");
+        return false;
+    }
+
+    field[0] = strtok(tmp, ",");
+    for (int i = 1; i < 9; i++) {
+        field[i] = field[i - 1] ? strtok(NULL, ",") : NULL;
+    }
+    if (field[8] == NULL) {
+        return false;
+    }
+    *server = ParseNumber(field[7], NULL);
+    *client = ParseNumber(field[8], NULL);
+    if (remote) {
+        strncpy(remote->ip, field[3], sizeof(remote->ip));
+        remote->ip[sizeof(remote->ip) - 1] = 0;
+        remote->port = ParseNumber(field[4], NULL);
+    }
+
+    debug_if(ism_debug, "transport_status id=%d server=%d client=%d\r\n", id, *server, *client);
+    return true;
+}
+
+bool ISM43362::set_keepalive(int id, int period_ms)
+{
+    if ((id < 0) || (id > 3)) {
+        return false;
+    }
+    if (_active_id != id) {
+        _active_id = id;
+        if (!(_parser.send("P0=%d", id) && check_response())) {
+            return false;
+        }
+    }
+
+    return _parser.send("PK=%d,%d", (period_ms > 0) ? 1 : 0, period_ms) && check_response();
+}
+
+int ISM43362::check_recv_status(int id, void *data, uint32_t size)
 {
+    ATTRACE_SCOPE("ism_recv");
     int read_amount;
-    static int keep_to = 0;
 
     debug_if(ism_debug, "ISM43362 req check_recv_status\r\n");
     /* Activate the socket id in the wifi module */
@@ -554,17 +929,32 @@ int ISM43362::check_recv_status(int id, void *data)
     /* MBED wifi driver is meant to be non-blocking, but we need anyway to
      * wait for some data on the RECV side to avoid overflow on TX side, the
      * tiemout is defined in higher layer */
-    if (keep_to != _timeout) {
+    if (_rx_timeout[id] != _timeout) {
         if (!(_parser.send("R2=%d", _timeout) && check_response())) {
             return -1;
         }
-        keep_to = _timeout;
+        _rx_timeout[id] = _timeout;
+    }
+
+    /* Bound the packet to the room left in data, with the trailer */
+    uint32_t packet_size = ES_WIFI_MAX_RX_PACKET_SIZE;
+    if (size < ES_WIFI_RX_BUFFER_SIZE) {
+        if (size <= ES_WIFI_RX_TRAILER_SIZE) {
+            return 0;
+        }
+        packet_size = size - ES_WIFI_RX_TRAILER_SIZE;
+    }
+    if (_rx_packet_size[id] != packet_size) {
+        if (!(_parser.send("R1=%d", packet_size) && check_response())) {
+            return -1;
+        }
+        _rx_packet_size[id] = packet_size;
     }
 
     if (!_parser.send("R0")) {
         return -1;
     }
-    read_amount = _parser.read((char *)data);
+    read_amount = _parser.read((char *)data, packet_size + ES_WIFI_RX_TRAILER_SIZE);
 
     if(read_amount < 0) {
         debug_if(ism_debug, "ERROR in data RECV, timeout?\r\n");
@@ -585,17 +975,15 @@ int ISM43362::check_recv_status(int id, void *data)
     if ((read_amount >= 6) && (strncmp("OK\r\n> ", (char *)data, 6) == 0)) {
         debug_if(ism_debug, "ISM4336 recv 2 nothing to read=%d\r\n", read_amount);
         return 0; /* nothing to read */
-    } else if ((read_amount >= 8) && (strncmp((char *)((uint32_t) data + read_amount - 8), "\r\nOK\r\n> ", 8)) == 0) {
+    } else if ((read_amount >= 8) && (strncmp((char *)data + read_amount - 8, "\r\nOK\r\n> ", 8)) == 0) {
         /* bypass ""\r\nOK\r\n> " if present at the end of the chain */
         read_amount -= 8;
     } else {
         debug_if(ism_debug, "ERROR in data RECV?, flushing %d bytes\r\n", read_amount);
-        int i = 0;
-        for (i = 0; i < read_amount; i++) {
+        for (int i = 0; i < read_amount; i++) {
              debug_if(ism_debug, "%2X ", cleanup[i]);
         }
-        cleanup[i] = 0;
-        debug_if(ism_debug, "\r\n%s\r\n", cleanup);
+        debug_if(ism_debug, "\r\n%.*s\r\n", read_amount, cleanup);
         return -1; /* nothing to read */
     }
 
@@ -605,6 +993,7 @@ int ISM43362::check_recv_status(int id, void *data)
 
 bool ISM43362::close(int id)
 {
+    ATTRACE_SCOPE("ism_close");
     if ((id <0) || (id > 3)) {
         debug_if(ism_debug,"Wrong socket number\n");
         return false;
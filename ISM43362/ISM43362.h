@@ -18,6 +18,10 @@
 #define ISM43362_H
 #include "ATParser.h"
 
+class BufferedSpi;
+class SpiRecorder;
+class FaultTransport;
+
 #define ES_WIFI_MAX_SSID_NAME_SIZE                  32
 #define ES_WIFI_MAX_PSWD_NAME_SIZE                  32
 #define ES_WIFI_PRODUCT_ID_SIZE                     32
@@ -31,6 +35,19 @@
 // R1 Set Read Transport Packet Size (bytes)
 #define ES_WIFI_MAX_RX_PACKET_SIZE                     1200
 
+// Buffer needed to read a packet followed by the "\r\nOK\r\n> " trailer
+#define ES_WIFI_RX_TRAILER_SIZE                        8
+#define ES_WIFI_RX_BUFFER_SIZE                         (ES_WIFI_MAX_RX_PACKET_SIZE + ES_WIFI_RX_TRAILER_SIZE)
+
+// Certificates are sent in a single frame, limited by the SPI transmit buffer
+#define ES_WIFI_MAX_CERT_SIZE                          4096
+
+// Credential set of the module the TLS certificates and key are stored in
+#define ES_WIFI_CERT_SET                               0
+
+// Accepted connection messages kept until their server accepts them
+#define ES_WIFI_ACCEPT_QUEUE_SIZE                      4
+
 /** ISM43362Interface class.
     This is an interface to a ISM43362 radio.
  */
@@ -38,6 +55,27 @@ class ISM43362
 {
 public:
     ISM43362(PinName mosi, PinName miso, PinName clk, PinName nss, PinName resetpin, PinName datareadypin, PinName wakeup, bool debug=false);
+
+    /** ISM43362 lifetime, for the UART variants of the module
+     * @param tx         UART transmit pin
+     * @param rx         UART receive pin
+     * @param resetpin   Reset pin
+     * @param wakeup     Wakeup pin
+     * @param debug      Enable debugging
+     * @param baud       UART baudrate
+     */
+    ISM43362(PinName tx, PinName rx, PinName resetpin, PinName wakeup, bool debug=false, int baud=115200);
+
+    /** ISM43362 lifetime, over an already created link to the module
+     *  e.g. a SpiReplay to run the driver against a recorded session
+     * @param transport  link to the module, deleted with the ISM43362
+     * @param resetpin   Reset pin
+     * @param wakeup     Wakeup pin
+     * @param debug      Enable debugging
+     */
+    ISM43362(ATTransport *transport, PinName resetpin, PinName wakeup, bool debug=false);
+
+    ~ISM43362();
     
     /**
     * Check firmware version of ISM43362
@@ -107,10 +145,24 @@ public:
 
     /* Return RSSI for active connection
      *
-     * @return      Measured RSSI
+     * @return      Measured RSSI, or 0 on failure
      */
     int8_t getRSSI();
 
+    /* Read RSSI for active connection
+     *
+     * @param rssi  Destination for the measured RSSI
+     * @return      true only if RSSI was read successfully
+     */
+    bool getRSSI(int8_t &rssi);
+
+    /* Read the BSSID of the access point the module joined
+     *
+     * @param bssid Destination for the 6 bytes of the BSSID
+     * @return      true only if C? reported a BSSID
+     */
+    bool getBSSID(uint8_t bssid[6]);
+
     /**
     * Check if ISM43362 is conenected
     *
@@ -138,7 +190,7 @@ public:
     /**
     * Open a socketed connection
     *
-    * @param type the type of socket to open "UDP" or "TCP"
+    * @param type the type of socket to open "0" for TCP, "1" for UDP, "3" for TLS
     * @param id id to give the new socket, valid 0-4
     * @param port port to open connection with
     * @param addr the IP address of the destination
@@ -146,6 +198,120 @@ public:
     */
     bool open(const char *type, int id, const char* addr, int port);
 
+    /**
+    * Load a TLS certificate or key into the module
+    *
+    * @param type 0 for the root CA certificate, 1 for the client certificate, 2 for the client key
+    * @param data PEM encoded certificate or key
+    * @param len length of data
+    * @return true only if the certificate was loaded successfully
+    */
+    bool set_certificate(int type, const char *data, uint32_t len);
+
+    /**
+    * Record the SPI frames exchanged with the module
+    *
+    * @param recorder recorder to log into, NULL to stop recording
+    * @return false if the module is not connected through SPI
+    */
+    bool record(SpiRecorder *recorder);
+
+    /**
+    * Insert fault injection between the AT parser and the module link
+    *
+    * @param faults fault injection link, NULL to remove it
+    */
+    void set_fault_injection(FaultTransport *faults);
+
+    /**
+    * Get the number of consecutive failed transfers with the module
+    *
+    * @return 0 as long as the module answers
+    */
+    int transfer_failures(void)
+    {
+        return _parser.failures();
+    }
+
+    /**
+    * Adapt the link timeout of each command to its observed response time
+    *
+    * @see ATParser::setTimeoutPolicy
+    */
+    void set_timeout_policy(int percent, int multiple, int floor_ms, int ceiling_ms)
+    {
+        _parser.setTimeoutPolicy(percent, multiple, floor_ms, ceiling_ms);
+    }
+
+    /**
+    * Get the per command statistics of the AT parser
+    *
+    * @param stats destination for the statistics
+    * @param count number of entries in stats
+    * @return number of entries filled, 0 unless built with ATPARSER_PROFILE
+    */
+    int get_command_stats(at_command_stats_t *stats, int count)
+    {
+        return _parser.get_stats(stats, count);
+    }
+
+    /**
+    * Clear the per command statistics of the AT parser
+    */
+    void reset_command_stats(void)
+    {
+        _parser.reset_stats();
+    }
+
+    /**
+    * Start a transport server listening for an incoming connection
+    *
+    * @param type the type of server to start "0" for TCP
+    * @param id id to give to the server socket, valid 0-3
+    * @param port local port to listen on
+    * @return true only if server started successfully
+    */
+    bool open_server(const char *type, int id, int port);
+
+    /**
+    * Check if a client connected to a transport server
+    *
+    * The client running flag of the server socket tells if it has a
+    * client, the module messages only give the client address
+    *
+    * @param id id of the server socket
+    * @param ip placeholder for the IP address of the client
+    * @param port placeholder for the port of the client
+    * @return 1 if a client was accepted, 0 if none, -1 on error
+    */
+    int accept(int id, char *ip, int *port);
+
+    /**
+    * Stop a transport server, closing its client connection if any
+    *
+    * @param id id of the server socket
+    * @return true only if server stopped successfully
+    */
+    bool close_server(int id);
+
+    /**
+    * Check if the connection of a socket is up, without reading its data
+    *
+    * @param id id of the socket
+    * @return 1 if the client connection of the socket runs, for client and
+    *         accepted sockets, 0 if it was closed, -1 on error
+    */
+    int socket_status(int id);
+
+    /**
+    * Enable or disable the TCP keep alive of a socket
+    *
+    * @param id id of the socket
+    * @param period_ms keep alive period, 0 to disable it
+    * @return true only if the keep alive was set successfully
+    */
+    bool set_keepalive(int id, int period_ms);
+
     /**
     * Sends data to an open socket
     *
@@ -202,10 +368,11 @@ public:
     * Check is datas are available to read for a socket
     * @param id socket id
     * @param data placeholder for returned information
-    * @param amount size to read for the check
+    * @param size size of data, a smaller packet than ES_WIFI_MAX_RX_PACKET_SIZE
+    *             is requested from the module if it is below ES_WIFI_RX_BUFFER_SIZE
     * @return amount of read value, or -1 for errors
     */
-    int check_recv_status(int id, void *data);
+    int check_recv_status(int id, void *data, uint32_t size = ES_WIFI_RX_BUFFER_SIZE);
     
     /**
     * Attach a function to call whenever network state has changed
@@ -219,13 +386,24 @@ public:
     }
 
 private:
-    BufferedSpi _bufferspi;
+    ATTransport *_transport;
+    BufferedSpi *_spi;
     ATParser _parser;
     DigitalOut _resetpin;
     volatile int _timeout;
     volatile int _active_id;
+    uint16_t _rx_packet_size[4]; /* last R1 of each socket, 0 if unknown */
+    int _rx_timeout[4];          /* last R2 of each socket, 0 if unknown */
+    int _tx_timeout[4];          /* last S2 of each socket, 0 if unknown */
+    struct accepted {
+        char ip[16];
+        int port;
+    } _accepted[ES_WIFI_ACCEPT_QUEUE_SIZE]; /* messages read, not yet accepted */
+    int _accepted_count;
     void print_rx_buff(void);
     bool check_response(void);
+    bool transport_status(int id, int *server, int *client, struct accepted *remote = NULL);
+    bool read_messages(void);
     struct packet {
         struct packet *next;
         int id;
@@ -17,6 +17,7 @@
 #include <string.h>
 #include "ISM43362Interface.h"
 #include "mbed_debug.h"
+#include "ATTrace.h"
 
 // ao activate  / de-activate debug
 #define ism_debug false
@@ -27,6 +28,35 @@
 #define ISM43362_RECV_TIMEOUT    100   /* milliseconds */
 #define ISM43362_MISC_TIMEOUT    100   /* milliseconds */
 
+// Roaming: minimum delay between two background scans, and max number of APs examined
+#define ISM43362_ROAMING_SCAN_INTERVAL 30000 /* milliseconds */
+#define ISM43362_ROAMING_SCAN_COUNT    10
+
+// Recovery: minimum delay between two module resets
+#define ISM43362_RECOVERY_INTERVAL 5000 /* milliseconds */
+
+// Event flag set at the end of a module operation run without the lock
+#define ISM43362_BUSY_DONE 0x1
+
+// Bit of _pending for the connection status changes, above the sockets
+#define ISM43362_STATUS_PENDING (1 << ISM43362_SOCKET_COUNT)
+
+// Below this room in the socket buffer, data stops being accumulated for ISM43362_RCVLOWAT
+#define ISM43362_RX_MIN_READ 64 /* bytes */
+
+// Read sizing of the sockets adapting to their traffic, see ISM43362_RCVADAPT
+#define ISM43362_RX_STREAM_BYTES    256  /* average bytes per read above which a socket is streaming */
+#define ISM43362_RX_SPARSE_TIMEOUT  10   /* milliseconds */
+
+// Period of the connection checks of the sockets the socket read thread does not read
+#define ISM43362_LIVENESS_INTERVAL 1000 /* milliseconds */
+
+// Bytes read from the module for all the sockets in one cycle of the socket read thread
+#define ISM43362_RX_CYCLE_BUDGET 4096 /* bytes */
+
+// Largest transmit queue of a socket, see ISM43362_SNDBUF
+#define ISM43362_TX_QUEUE_MAX 8192 /* bytes */
+
 // Tested firmware versions
 // Example of versions string returned by the module:
 // "ISM43362-M3G-L44-SPI,C3.5.2.3.BETA9,v3.5.2,v1.4.0.rc1,v8.2.1,120000000,Inventek eS-WiFi"
@@ -35,17 +65,129 @@
 const char supported_fw_versions[2][15] = {"C3.5.2.3.BETA9", "C3.5.2.2"};
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
+#define MAX(a,b) (((a)>(b))?(a):(b))
+
+// Account a socket statistic, both for the socket and the whole interface
+#define SOCKET_STAT_ADD(socket, field, n) do { \
+        (socket)->stats.field += (n);             \
+        _stats.sockets.field += (n);              \
+    } while (0)
 
 // ISM43362Interface implementation
 ISM43362Interface::ISM43362Interface(PinName mosi, PinName miso, PinName sclk, PinName nss, PinName reset, PinName datareadypin, PinName wakeup, bool debug)
     : _ism(mosi, miso, sclk, nss, reset, datareadypin, wakeup, debug)
 {
+    init();
+}
+
+ISM43362Interface::ISM43362Interface(PinName tx, PinName rx, PinName reset, PinName wakeup, bool debug)
+    : _ism(tx, rx, reset, wakeup, debug)
+{
+    init();
+}
+
+ISM43362Interface::ISM43362Interface(ATTransport *transport, PinName reset, PinName wakeup, bool debug)
+    : _ism(transport, reset, wakeup, debug)
+{
+    init();
+}
+
+ISM43362Interface::~ISM43362Interface()
+{
+    thread_read_socket.terminate();
+}
+
+void ISM43362Interface::init()
+{
+    /* read by lock(), before the statistics are reset */
+    _busy.active = false;
+    _busy.deferred = false;
     memset(_ids, 0, sizeof(_ids));
     memset(_socket_obj, 0, sizeof(_socket_obj));
-    memset(_cbs, 0, sizeof(_cbs));
+    _pending = 0;
+    _queue = NULL;
+    _dispatch_posted = false;
+    _status.head = 0;
+    _status.count = 0;
+    _status.dispatching = false;
+    _connected = false;
+    _blocking = true;
+    _conn_status = NSAPI_STATUS_DISCONNECTED;
+    _connecting.state = CONNECT_IDLE;
+    _connecting.cancel = 0;
+    _connecting.async = false;
+    _pool.enabled = false;
+    _pool.idle_timeout = 0;
+    for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
+        _pool.entries[i].idle = false;
+    }
+    _rssi.sample_period = 0;
+    _rssi.last_sample = 0;
+    reset_rssi_stats();
+    reset_stats();
+    _roaming.threshold = 0;
+    _roaming.hysteresis = 0;
+    _roaming.last_scan = -ISM43362_ROAMING_SCAN_INTERVAL;
+    _poll.waiting = false;
+    _recovery.threshold = 0;
+    _recovery.last_attempt = -ISM43362_RECOVERY_INTERVAL;
+    memset(&_recovery.stats, 0, sizeof(_recovery.stats));
+    _timer.start();
     thread_read_socket.start(callback(this, &ISM43362Interface::socket_check_read));
 }
 
+/*  Take the interface lock, accounting the time spent blocked on it.
+ *  Callers accessing the module also wait for the end of a busy module
+ *  operation, the others only use the driver state and go on meanwhile */
+void ISM43362Interface::lock(bool module)
+{
+    bool locked = _mutex.trylock();
+    if (locked && !(module && _busy.active)) {
+        return;
+    }
+
+    uint32_t start = us_ticker_read();
+    ATTRACE_BEGIN("lock_wait");
+    if (!locked) {
+        _mutex.lock();
+    }
+    while (module && _busy.active) {
+        _mutex.unlock();
+        _busy.done.wait_any(ISM43362_BUSY_DONE, osWaitForever, false);
+        _mutex.lock();
+    }
+    ATTRACE_END("lock_wait");
+    uint32_t waited = us_ticker_read() - start;
+    _stats.lock_contentions++;
+    _stats.lock_wait_us += waited;
+    _stats.lock_wait_max_us = MAX(_stats.lock_wait_max_us, waited);
+}
+
+/*  Mark the module busy, called with the lock held before releasing it
+ *  for a long module operation */
+void ISM43362Interface::busy_begin()
+{
+    _busy.done.clear(ISM43362_BUSY_DONE);
+    _busy.active = true;
+}
+
+/*  End a busy module operation, called with the lock held
+ *  @return true if a socket call was refused meanwhile */
+bool ISM43362Interface::busy_end()
+{
+    _busy.active = false;
+    _busy.done.set(ISM43362_BUSY_DONE);
+    bool deferred = _busy.deferred;
+    _busy.deferred = false;
+    return deferred;
+}
+
+/*  Release the interface lock taken by lock() */
+void ISM43362Interface::unlock()
+{
+    _mutex.unlock();
+}
+
 int ISM43362Interface::connect(const char *ssid, const char *pass, nsapi_security_t security,
                                         uint8_t channel)
 {
@@ -57,44 +199,156 @@ int ISM43362Interface::connect(const char *ssid, const char *pass, nsapi_securit
     return connect();
 }
 
+/*  In non-blocking mode, the connection steps are run by the socket read
+ *  thread and the result is reported through the status callback */
 int ISM43362Interface::connect()
+{
+    lock();
+    if (_connecting.state != CONNECT_IDLE) {
+        unlock();
+        return NSAPI_ERROR_BUSY;
+    }
+    if (_connected) {
+        unlock();
+        return NSAPI_ERROR_IS_CONNECTED;
+    }
+    _connecting.state = CONNECT_VERSION;
+    _connecting.cancel = 0;
+    _connecting.async = !_blocking;
+    unlock();
+
+    set_status(NSAPI_STATUS_CONNECTING);
+
+    if (!_blocking) {
+        return NSAPI_ERROR_OK;
+    }
+
+    int ret;
+    do {
+        ret = connect_step();
+    } while (ret == NSAPI_ERROR_IN_PROGRESS);
+
+    return ret;
+}
+
+/*  Run the next step of the connection
+ *  @return NSAPI_ERROR_IN_PROGRESS until the connection is over */
+int ISM43362Interface::connect_step()
 {
     const char* read_version;
+    int ret = NSAPI_ERROR_IN_PROGRESS;
+
+    lock();
+    if (_connecting.cancel) {
+        debug_if(ism_debug, "ISM43362: connection cancelled\r\n");
+        if (_connecting.state == CONNECT_IP) {
+            /* the module already joined the network */
+            _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+            _ism.disconnect();
+        }
+        ret = _connecting.cancel;
+    } else switch (_connecting.state) {
+        case CONNECT_VERSION:
+            _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+
+            // Check all supported firmware versions
+            read_version = _ism.get_firmware_version();
+
+            if (!read_version) {
+                debug_if(ism_debug, "ISM43362: ERROR cannot read firmware version\r\n");
+                ret = NSAPI_ERROR_DEVICE_ERROR;
+                break;
+            }
+            debug_if(ism_debug, "ISM43362: read_version = [%s]\r\n", read_version);
 
-    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+            if ((strcmp(read_version, supported_fw_versions[0]) == 0) || (strcmp(read_version, supported_fw_versions[1]) == 0)) {
+                debug_if(ism_debug, "ISM43362: firmware version is OK\r\n");
+            } else {
+                debug_if(ism_debug, "ISM43362: WARNING this firmware version has not been tested !\r\n");
+            }
+            _connecting.state = CONNECT_DHCP;
+            break;
 
-    // Check all supported firmware versions
-    read_version = _ism.get_firmware_version();
+        case CONNECT_DHCP:
+            if (!_ism.dhcp(true)) {
+                ret = NSAPI_ERROR_DHCP_FAILURE;
+                break;
+            }
+            _connecting.state = CONNECT_JOIN;
+            break;
 
-    if (!read_version) {
-        debug_if(ism_debug, "ISM43362: ERROR cannot read firmware version\r\n");
-        return NSAPI_ERROR_DEVICE_ERROR;
+        case CONNECT_JOIN:
+            _ism.setTimeout(ISM43362_CONNECT_TIMEOUT);
+            if (!_ism.connect(ap_ssid, ap_pass)) {
+                ret = NSAPI_ERROR_NO_CONNECTION;
+                break;
+            }
+            _connecting.state = CONNECT_IP;
+            break;
+
+        case CONNECT_IP:
+            _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+            if (!_ism.getIPAddress()) {
+                ret = NSAPI_ERROR_DHCP_FAILURE;
+                break;
+            }
+            _connected = true;
+            ret = NSAPI_ERROR_OK;
+            break;
+
+        default:
+            ret = NSAPI_ERROR_NO_CONNECTION;
+            break;
     }
-    debug_if(ism_debug, "ISM43362: read_version = [%s]\r\n", read_version);
 
-    if ((strcmp(read_version, supported_fw_versions[0]) == 0) || (strcmp(read_version, supported_fw_versions[1]) == 0)) {
-        debug_if(ism_debug, "ISM43362: firmware version is OK\r\n");
-    } else {
-        debug_if(ism_debug, "ISM43362: WARNING this firmware version has not been tested !\r\n");
+    if (ret != NSAPI_ERROR_IN_PROGRESS) {
+        _connecting.state = CONNECT_IDLE;
     }
+    unlock();
 
-    if (!_ism.dhcp(true)) {
-        return NSAPI_ERROR_DHCP_FAILURE;
+    if (ret != NSAPI_ERROR_IN_PROGRESS) {
+        set_status((ret == NSAPI_ERROR_OK) ? NSAPI_STATUS_GLOBAL_UP : NSAPI_STATUS_DISCONNECTED);
     }
 
-    _ism.setTimeout(ISM43362_CONNECT_TIMEOUT);
+    return ret;
+}
 
-    if (!_ism.connect(ap_ssid, ap_pass)) {
-        return NSAPI_ERROR_NO_CONNECTION;
+/*  Record a connection status change, the lock must not be taken. The
+ *  changes are queued in order and dispatched like the socket events, the
+ *  oldest one being dropped when the queue is full */
+void ISM43362Interface::set_status(nsapi_connection_status_t status)
+{
+    lock(false);
+    _conn_status = status;
+    if (_status_cb) {
+        if (_status.count == ISM43362_STATUS_QUEUE_SIZE) {
+            _status.head = (_status.head + 1) % ISM43362_STATUS_QUEUE_SIZE;
+            _status.count--;
+        }
+        _status.queue[(_status.head + _status.count) % ISM43362_STATUS_QUEUE_SIZE] = status;
+        _status.count++;
+        _pending |= ISM43362_STATUS_PENDING;
     }
+    unlock();
 
-    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
-    if (!_ism.getIPAddress()) {
-        return NSAPI_ERROR_DHCP_FAILURE;
-    }
+    notify_dispatch();
+}
 
-    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+void ISM43362Interface::attach(Callback<void(nsapi_event_t, intptr_t)> status_cb)
+{
+    lock();
+    _status_cb = status_cb;
+    unlock();
+}
+
+nsapi_connection_status_t ISM43362Interface::get_connection_status() const
+{
+    return _conn_status;
+}
 
+nsapi_error_t ISM43362Interface::set_blocking(bool blocking)
+{
+    _blocking = blocking;
     return NSAPI_ERROR_OK;
 }
 
@@ -141,9 +395,27 @@ int ISM43362Interface::set_channel(uint8_t channel)
 
 int ISM43362Interface::disconnect()
 {
+    lock();
+    if (_connecting.state != CONNECT_IDLE) {
+        /* the connection steps stop and report the disconnection */
+        _connecting.cancel = NSAPI_ERROR_NO_CONNECTION;
+        unlock();
+        return NSAPI_ERROR_OK;
+    }
+    _connected = false;
+    for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
+        if (_pool.entries[i].idle) {
+            pool_drop(i);
+        }
+    }
+    unlock();
+
     _ism.setTimeout(ISM43362_MISC_TIMEOUT);
 
-    if (!_ism.disconnect()) {
+    bool ok = _ism.disconnect();
+    set_status(NSAPI_STATUS_DISCONNECTED);
+
+    if (!ok) {
         return NSAPI_ERROR_DEVICE_ERROR;
     }
 
@@ -172,7 +444,84 @@ const char *ISM43362Interface::get_netmask()
 
 int8_t ISM43362Interface::get_rssi()
 {
-    return _ism.getRSSI();
+    if (_rssi.sample_period != 0) {
+        /* Served from the RSSI monitor, 0 until a first sample is taken */
+        return _rssi.stats.last;
+    }
+
+    lock();
+    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+    int8_t rssi = _ism.getRSSI();
+    unlock();
+
+    return rssi;
+}
+
+int ISM43362Interface::set_rssi_monitor(uint32_t sample_period_ms)
+{
+    lock();
+    _rssi.sample_period = sample_period_ms;
+    _rssi.last_sample = _timer.read_ms() - sample_period_ms;
+    unlock();
+
+    return NSAPI_ERROR_OK;
+}
+
+int ISM43362Interface::get_rssi_stats(ism43362_rssi_stats_t *stats)
+{
+    lock();
+    *stats = _rssi.stats;
+    unlock();
+
+    return (stats->samples != 0) ? NSAPI_ERROR_OK : NSAPI_ERROR_NO_CONNECTION;
+}
+
+void ISM43362Interface::reset_rssi_stats()
+{
+    lock();
+    memset(&_rssi.stats, 0, sizeof(_rssi.stats));
+    _rssi.average_x16 = 0;
+    unlock();
+}
+
+void ISM43362Interface::get_stats(ism43362_interface_stats_t *stats)
+{
+    lock();
+    *stats = _stats;
+    unlock();
+}
+
+void ISM43362Interface::reset_stats()
+{
+    lock();
+    memset(&_stats, 0, sizeof(_stats));
+    unlock();
+}
+
+int ISM43362Interface::record(SpiRecorder *recorder)
+{
+    lock();
+    bool ret = _ism.record(recorder);
+    unlock();
+
+    return ret ? 0 : NSAPI_ERROR_UNSUPPORTED;
+}
+
+void ISM43362Interface::set_fault_injection(FaultTransport *faults)
+{
+    lock();
+    _ism.set_fault_injection(faults);
+    unlock();
+}
+
+int ISM43362Interface::get_command_stats(at_command_stats_t *stats, int count)
+{
+    return _ism.get_command_stats(stats, count);
+}
+
+void ISM43362Interface::reset_command_stats()
+{
+    _ism.reset_command_stats();
 }
 
 int ISM43362Interface::scan(WiFiAccessPoint *res, unsigned count)
@@ -181,6 +530,62 @@ int ISM43362Interface::scan(WiFiAccessPoint *res, unsigned count)
     return _ism.scan(res, count);
 }
 
+int ISM43362Interface::set_tls_credential(ism43362_tls_credential_t type, const char *pem)
+{
+    if (!pem || strlen(pem) > ES_WIFI_MAX_CERT_SIZE) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    lock();
+    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+    bool ok = _ism.set_certificate(type, pem, strlen(pem));
+    unlock();
+
+    return ok ? NSAPI_ERROR_OK : NSAPI_ERROR_DEVICE_ERROR;
+}
+
+int ISM43362Interface::set_connection_pool(bool enabled, uint32_t idle_timeout_ms)
+{
+    lock();
+    _pool.enabled = enabled;
+    _pool.idle_timeout = idle_timeout_ms;
+    if (!enabled) {
+        for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
+            if (_pool.entries[i].idle) {
+                pool_drop(i);
+            }
+        }
+    }
+    unlock();
+
+    return NSAPI_ERROR_OK;
+}
+
+int ISM43362Interface::set_roaming(int8_t rssi_threshold, uint8_t hysteresis, uint32_t sample_period_ms)
+{
+    if (rssi_threshold > 0 || sample_period_ms == 0) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    lock();
+    _roaming.threshold = rssi_threshold;
+    _roaming.hysteresis = hysteresis;
+    unlock();
+
+    if (rssi_threshold != 0) {
+        return set_rssi_monitor(sample_period_ms);
+    }
+
+    return NSAPI_ERROR_OK;
+}
+
+void ISM43362Interface::attach_roaming(Callback<void(bool)> cb)
+{
+    lock();
+    _roaming.cb = cb;
+    unlock();
+}
+
 struct ISM43362_socket {
     int id;
     nsapi_protocol_t proto;
@@ -188,189 +593,1160 @@ struct ISM43362_socket {
     SocketAddress addr;
     char read_data[1400];
     volatile uint32_t read_data_size;
+    uint16_t local_port;
+    bool tls;
+    /* Server side: the module socket is shared between the listening socket
+     * and the connection accepted from it */
+    bool listening;
+    bool accepted;
+    volatile bool accept_pending;
+    SocketAddress accept_addr;
+    struct ISM43362_socket *server;
+    struct ISM43362_socket *client;
+    /* Callback of the socket: a server and its accepted client share the
+     * module socket, but each keeps its own callback */
+    void (*callback)(void *);
+    void *data;
+    bool polled;        /* a thread waits on the socket in ISM43362Interface::poll */
+    uint32_t rcvlowat;
+    uint32_t rcvlowat_ms;
+    volatile bool rx_signaled; /* the buffered data was signaled to the application */
+    /* Transmit queue, a ring buffer drained by the socket read thread */
+    char *tx_queue;
+    uint32_t tx_size;
+    uint32_t tx_head;
+    volatile uint32_t tx_count;
+    bool tx_full;       /* a send was refused, signal the socket when the queue drains */
+    int tx_error;       /* error of the last queued send, reported by the next send */
+    /* Module settings, sent with the next module access */
+    uint16_t rx_packet;
+    uint32_t recv_timeout;
+    uint32_t send_timeout;
+    int keepalive;
+    int keepidle;       /* keep alive period enabled by NSAPI_KEEPALIVE */
+    bool keepalive_dirty;
+    bool rx_adaptive;
+    int live_check;     /* time of the last data moved or connection check, in milliseconds */
+    uint32_t rx_average_x16; /* moving average of the bytes per module read, fixed point 1/16 */
+    ism43362_socket_stats_t stats;
+    bool data_timed;    /* data_time holds when buffered data was read from the module */
+    uint32_t data_time;
+    bool recovering;    /* lost by a module reset, reopened once the network is back */
 };
 
+static void socket_init(struct ISM43362_socket *socket, int id, nsapi_protocol_t proto)
+{
+    socket->id = id;
+    memset(socket->read_data, 0, sizeof(socket->read_data));
+    socket->addr = 0;
+    socket->read_data_size = 0;
+    socket->proto = proto;
+    socket->connected = false;
+    socket->local_port = 0;
+    socket->tls = false;
+    socket->listening = false;
+    socket->accepted = false;
+    socket->accept_pending = false;
+    socket->server = NULL;
+    socket->client = NULL;
+    socket->callback = 0;
+    socket->data = 0;
+    socket->polled = false;
+    socket->rcvlowat = 1;
+    socket->rcvlowat_ms = 0;
+    socket->rx_signaled = false;
+    socket->tx_queue = NULL;
+    socket->tx_size = 0;
+    socket->tx_head = 0;
+    socket->tx_count = 0;
+    socket->tx_full = false;
+    socket->tx_error = 0;
+    socket->rx_packet = ES_WIFI_MAX_RX_PACKET_SIZE;
+    socket->recv_timeout = ISM43362_RECV_TIMEOUT;
+    socket->send_timeout = ISM43362_SEND_TIMEOUT;
+    socket->keepalive = 0;
+    socket->keepidle = ISM43362_KEEPIDLE_DEFAULT;
+    socket->keepalive_dirty = false;
+    socket->rx_adaptive = true;
+    socket->live_check = 0;
+    socket->rx_average_x16 = 0;
+    memset(&socket->stats, 0, sizeof(socket->stats));
+    socket->data_timed = false;
+    socket->recovering = false;
+}
+
 int ISM43362Interface::socket_open(void **handle, nsapi_protocol_t proto)
 {
+    lock();
     // Look for an unused socket
     int id = -1;
     for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
         if (!_ids[i]) {
             id = i;
-            _ids[i] = true;
             break;
         }
     }
 
+    // Otherwise close the least recently used idle connection of the pool
+    if (id == -1) {
+        for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
+            if (_pool.entries[i].idle && ((id == -1)
+                    || (_pool.entries[i].released - _pool.entries[id].released < 0))) {
+                id = i;
+            }
+        }
+        if (id != -1) {
+            pool_drop(id);
+        }
+    }
+
     if (id == -1) {
+        unlock();
         return NSAPI_ERROR_NO_SOCKET;
     }
-    _mutex.lock();
+    _ids[id] = true;
+
     struct ISM43362_socket *socket = new struct ISM43362_socket;
     if (!socket) {
+        _ids[id] = false;
+        unlock();
         return NSAPI_ERROR_NO_SOCKET;
     }
-    socket->id = id;
+    socket_init(socket, id, proto);
     debug_if(ism_debug, "socket_open, id=%d", socket->id);
-    memset(socket->read_data, 0, sizeof(socket->read_data));
-    socket->addr = 0;
-    socket->read_data_size = 0;
-    socket->proto = proto;
-    socket->connected = false;
     *handle = socket;
-    _mutex.unlock();
+    unlock();
 
     return 0;
 }
 
 int ISM43362Interface::socket_close(void *handle)
 {
-    _mutex.lock();
+    ATTRACE_SCOPE("socket_close");
+    lock();
     struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
     debug_if(ism_debug, "socket_close, id=%d", socket->id);
     int err = 0;
+
+    /* Queued data is sent before closing */
+    if (socket->connected) {
+        socket_tx_drain(socket);
+    }
+    delete[] socket->tx_queue;
+    socket->tx_queue = NULL;
     _ism.setTimeout(ISM43362_MISC_TIMEOUT);
- 
-    if (!_ism.close(socket->id)) {
-        err = NSAPI_ERROR_DEVICE_ERROR;
+
+    /* Only a connection still up, with no data left unread, is kept */
+    bool pooled = false;
+    if (_pool.enabled && socket->connected && (socket->proto == NSAPI_TCP) && !socket->accepted
+            && !socket->listening && (socket->read_data_size == 0)) {
+        pooled = (_ism.socket_status(socket->id) == 1);
+    }
+
+    if (socket->listening && socket->client) {
+        /* The module socket remains in use by the accepted connection */
+        socket->client->server = NULL;
+    } else if (socket->accepted && socket->server) {
+        /* Restart the server so that it can accept the next client */
+        if (!(_ism.close_server(socket->id)
+                && _ism.open_server("0", socket->id, socket->server->local_port))) {
+            err = NSAPI_ERROR_DEVICE_ERROR;
+        }
+        socket->server->client = NULL;
+        _socket_obj[socket->id] = (uintptr_t)socket->server;
+    } else if (pooled) {
+        /* Keep the module connection open, and the module socket reserved */
+        debug_if(ism_debug, "socket_close, id=%d kept in pool", socket->id);
+        _pool.entries[socket->id].idle = true;
+        _pool.entries[socket->id].tls = socket->tls;
+        _pool.entries[socket->id].addr = socket->addr;
+        _pool.entries[socket->id].released = _timer.read_ms();
+        _pool.entries[socket->id].keepalive = socket->keepalive_dirty ? -1 : socket->keepalive;
+        _socket_obj[socket->id] = 0;
+    } else {
+        if (socket->listening || socket->accepted) {
+            if (!_ism.close_server(socket->id)) {
+                err = NSAPI_ERROR_DEVICE_ERROR;
+            }
+        } else if (!_ism.close(socket->id)) {
+            err = NSAPI_ERROR_DEVICE_ERROR;
+        }
+        _ids[socket->id] = false;
+        _socket_obj[socket->id] = 0;
+    }
+    /* Events of the closed socket are dropped, unless they belong to the
+     * connection accepted from it */
+    if (!(socket->listening && socket->client)) {
+        _pending &= ~(1 << socket->id);
     }
 
     socket->connected = false;
-    _ids[socket->id] = false;
-    _socket_obj[socket->id] = 0;
-    _mutex.unlock();
+    unlock();
     delete socket;
     return err;
 }
 
 int ISM43362Interface::socket_bind(void *handle, const SocketAddress &address)
 {
-    return NSAPI_ERROR_UNSUPPORTED;
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+
+    /* Only TCP server sockets are supported */
+    if (socket->proto != NSAPI_TCP) {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+
+    if (address.get_port() == 0) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    lock();
+    socket->local_port = address.get_port();
+    unlock();
+
+    return 0;
 }
 
+/*  The module handles one client connection per server socket, so the
+ *  backlog is always 1 */
 int ISM43362Interface::socket_listen(void *handle, int backlog)
 {
-    return NSAPI_ERROR_UNSUPPORTED;
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+
+    lock();
+    if ((socket->local_port == 0) || socket->connected) {
+        unlock();
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+    if (!_ism.open_server("0", socket->id, socket->local_port)) {
+        unlock();
+        return NSAPI_ERROR_DEVICE_ERROR;
+    }
+
+    socket->listening = true;
+    _socket_obj[socket->id] = (uintptr_t)socket;
+    unlock();
+
+    return 0;
 }
 
 int ISM43362Interface::socket_connect(void *handle, const SocketAddress &addr)
 {
-    _mutex.lock();
+    ATTRACE_SCOPE("socket_connect");
+    lock();
     int ret = socket_connect_nolock(handle, addr);
-    _mutex.unlock();
+    unlock();
     return ret;
 }
 
 int ISM43362Interface::socket_connect_nolock(void *handle, const SocketAddress &addr)
 {
     struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+
+    if (_pool.enabled && (socket->proto == NSAPI_TCP) && pool_reuse(socket, addr)) {
+        return 0;
+    }
+
     _ism.setTimeout(ISM43362_CONNECT_TIMEOUT);
-    const char *proto = (socket->proto == NSAPI_UDP) ? "1" : "0";
+    const char *proto = (socket->proto == NSAPI_UDP) ? "1" : (socket->tls ? "3" : "0");
     if (!_ism.open(proto, socket->id, addr.get_ip_address(), addr.get_port())) {
+        SOCKET_STAT_ADD(socket, connect_errors, 1);
         return NSAPI_ERROR_DEVICE_ERROR;
     }
     _ids[socket->id]  = true;
-    _socket_obj[socket->id] = (uint32_t)socket;
+    _socket_obj[socket->id] = (uintptr_t)socket;
     socket->connected = true;
+    socket->addr = addr;
+    /* A new module connection starts without keep alive */
+    socket->keepalive_dirty = (socket->keepalive != 0);
     return 0;
 
 }
 
+/*  Look for an idle connection to the same address and move the socket on it */
+bool ISM43362Interface::pool_reuse(void *handle, const SocketAddress &addr)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
 
+    for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
+        if (!_pool.entries[i].idle || (_pool.entries[i].tls != socket->tls)
+                || (_pool.entries[i].addr != addr)) {
+            continue;
+        }
 
-void ISM43362Interface::socket_check_read()
-{
-    while (1) {
-        for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
-            _mutex.lock();
-            if (_socket_obj[i] != 0) {
-                struct ISM43362_socket *socket = (struct ISM43362_socket *)_socket_obj[i];
-                /* Check if there is something to read for this socket. But if it */
-                /* has already been read : don't read again */
-                if ((socket->connected) && (socket->read_data_size == 0) && _cbs[socket->id].callback) {
-                    _ism.setTimeout(1);
-                    /* if no callback is set, no need to read ?*/
-                    int read_amount = _ism.check_recv_status(socket->id, socket->read_data);
-                    if (read_amount > 0) {
-                        socket->read_data_size = read_amount;
-                    } else if (read_amount < 0) {
-                        /* Mark donw connection has been lost or closed */
-                        socket->connected = false;
-                    }
-                    if (read_amount != 0) {
-                        /* There is something to read in this socket*/
-                        if (_cbs[socket->id].callback) {
-                            _cbs[socket->id].callback(_cbs[socket->id].data);
-                       }
-                    }
-                }
-            }
-            _mutex.unlock();
+        /* Liveness check: the connection state is asked first, then data
+         * received while idle means the connection can't be reused as is */
+        _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+        int read_amount = (_ism.socket_status(i) == 1) ? 0 : -1;
+        if (read_amount == 0) {
+            _ism.setTimeout(1);
+            read_amount = _ism.check_recv_status(i, socket->read_data, socket->rx_packet + ES_WIFI_RX_TRAILER_SIZE);
+        }
+        if (read_amount != 0) {
+            debug_if(ism_debug, "pool: connection id=%d not reusable (%d)\r\n", i, read_amount);
+            pool_drop(i);
+            continue;
+        }
+
+        debug_if(ism_debug, "pool: socket id=%d reuses connection id=%d\r\n", socket->id, i);
+        _pool.entries[i].idle = false;
+        _ids[socket->id] = false;
+        _pending &= ~(1 << socket->id);
+        socket->id = i;
+        _socket_obj[i] = (uintptr_t)socket;
+        socket->connected = true;
+        socket->addr = addr;
+        /* The keep alive of the previous connection stays in the module */
+        socket->keepalive_dirty = (_pool.entries[i].keepalive != socket->keepalive);
+        /* The traffic of the previous connection says nothing of this one */
+        socket->rx_average_x16 = 0;
+        if (socket->rx_adaptive) {
+            socket->rx_packet = ES_WIFI_MAX_RX_PACKET_SIZE;
+            socket->recv_timeout = ISM43362_RECV_TIMEOUT;
         }
-        wait_ms(50);
+        return true;
     }
+
+    return false;
 }
 
-int ISM43362Interface::socket_accept(void *server, void **socket, SocketAddress *addr)
+void ISM43362Interface::pool_drop(int id)
 {
-    return NSAPI_ERROR_UNSUPPORTED;
+    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+    _ism.close(id);
+    _pool.entries[id].idle = false;
+    _ids[id] = false;
 }
 
-int ISM43362Interface::socket_send(void *handle, const void *data, unsigned size)
+void ISM43362Interface::pool_expire()
 {
-    _mutex.lock();
-    int ret = socket_send_nolock(handle, data, size);
-    _mutex.unlock();
-    return ret;
+    int now = _timer.read_ms();
+
+    for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
+        if (_pool.entries[i].idle && ((uint32_t)(now - _pool.entries[i].released) > _pool.idle_timeout)) {
+            debug_if(ism_debug, "pool: idle connection id=%d expired\r\n", i);
+            pool_drop(i);
+        }
+    }
 }
 
-/*  CAREFULL LOCK must be taken before callling this function */
-int ISM43362Interface::socket_send_nolock(void *handle, const void *data, unsigned size)
+
+
+/*  Account a module read of the socket, lock must be taken */
+void ISM43362Interface::socket_account_read(void *handle, int read_amount)
 {
     struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
-    _ism.setTimeout(ISM43362_SEND_TIMEOUT);
 
-    if (size > ES_WIFI_MAX_RX_PACKET_SIZE) {
+    SOCKET_STAT_ADD(socket, polls, 1);
+    if (read_amount == 0) {
+        SOCKET_STAT_ADD(socket, empty_polls, 1);
+        if (socket->rx_adaptive) {
+            /* the stream stopped: idle reads must not hold the module */
+            socket->recv_timeout = ISM43362_RX_SPARSE_TIMEOUT;
+        }
+    } else if (read_amount < 0) {
+        SOCKET_STAT_ADD(socket, recv_errors, 1);
+    } else if (!socket->data_timed) {
+        /* time the oldest buffered data */
+        socket->data_timed = true;
+        socket->data_time = us_ticker_read();
+    }
+    if (read_amount > 0) {
+        /* the connection is known alive for another interval */
+        socket->live_check = _timer.read_ms();
+        uint32_t buffered = socket->read_data_size + read_amount;
+        socket->stats.rx_high_water = MAX(socket->stats.rx_high_water, buffered);
+        _stats.sockets.rx_high_water = MAX(_stats.sockets.rx_high_water, buffered);
+        socket_rx_adapt(socket, read_amount);
+    }
+}
+
+/*  Size the module reads of a socket after its recent traffic, lock must be taken.
+ *  A flowing stream gets the largest packets and the default read timeout,
+ *  sparse traffic small packets and a short read timeout. Only reads that
+ *  returned data are averaged, the empty polls in between say nothing of
+ *  the size of the bursts */
+void ISM43362Interface::socket_rx_adapt(void *handle, int read_amount)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+
+    if (!socket->rx_adaptive) {
+        return;
+    }
+
+    socket->rx_average_x16 = socket->rx_average_x16 - (socket->rx_average_x16 >> 3) + ((read_amount * 16) >> 3);
+
+    uint32_t average = socket->rx_average_x16 / 16;
+    if ((average >= ISM43362_RX_STREAM_BYTES) || (read_amount >= socket->rx_packet)) {
+        /* a full packet means more data is pending in the module */
+        socket->rx_packet = ES_WIFI_MAX_RX_PACKET_SIZE;
+        socket->recv_timeout = ISM43362_RECV_TIMEOUT;
+    } else {
+        /* powers of two, so that R1 only changes with the order of the traffic */
+        uint32_t packet = ISM43362_RX_MIN_READ;
+        while ((packet < 2 * average) && (packet < ES_WIFI_MAX_RX_PACKET_SIZE)) {
+            packet *= 2;
+        }
+        socket->rx_packet = MIN(packet, ES_WIFI_MAX_RX_PACKET_SIZE);
+        socket->recv_timeout = ISM43362_RX_SPARSE_TIMEOUT;
+    }
+}
+
+/*  Check if the buffered data of a socket is worth signaling, lock must be taken */
+bool ISM43362Interface::socket_rx_due(void *handle)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+
+    if (socket->read_data_size == 0) {
+        return false;
+    }
+    if ((socket->read_data_size >= socket->rcvlowat)
+            || (sizeof(socket->read_data) - socket->read_data_size < ISM43362_RX_MIN_READ)) {
+        return true;
+    }
+    return (socket->rcvlowat_ms != 0) && socket->data_timed
+           && ((us_ticker_read() - socket->data_time) / 1000 >= socket->rcvlowat_ms);
+}
+
+void ISM43362Interface::socket_check_read()
+{
+    int first = 0;
+
+    while (1) {
+        /* The sockets share a read budget per cycle, starting with a different
+         * socket at each cycle for fairness */
+        int budget = ISM43362_RX_CYCLE_BUDGET;
+        bool pending = false;
+        first = (first + 1) % ISM43362_SOCKET_COUNT;
+        for (int n = 0; n < ISM43362_SOCKET_COUNT; n++) {
+            int i = (first + n) % ISM43362_SOCKET_COUNT;
+            ATTRACE_SCOPE("poll");
+            lock();
+            if (_socket_obj[i] != 0) {
+                struct ISM43362_socket *socket = (struct ISM43362_socket *)_socket_obj[i];
+                /* Check if a client connected to a server socket, until it is accepted */
+                bool waited = socket->callback || socket->polled;
+                if (socket->listening && !socket->accept_pending && waited) {
+                    char ip[16];
+                    int port;
+                    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+                    if (_ism.accept(socket->id, ip, &port) > 0) {
+                        socket->accept_addr = SocketAddress(ip, port);
+                        socket->accept_pending = true;
+                        socket_ready(socket);
+                        socket_notify(socket->id);
+                    }
+                }
+                /* Check if there is something to read for this socket. But if it */
+                /* has already been signaled : don't read again until it is read. */
+                /* Below ISM43362_RCVLOWAT, data is accumulated */
+                /* A full packet means more data is pending in the module: it is */
+                /* read in the same cycle while there is room and budget left */
+                uint32_t room = sizeof(socket->read_data) - socket->read_data_size;
+                room = MIN(room, socket->rx_packet + ES_WIFI_RX_TRAILER_SIZE);
+                bool reading = (socket->connected) && !socket->rx_signaled && (room >= ISM43362_RX_MIN_READ) && waited;
+                if (reading && (budget > 0)) {
+                    /* Same timeout as socket_recv(), so that R2 only changes
+                     * with the traffic of the socket */
+                    _ism.setTimeout(socket->recv_timeout);
+                    bool full;
+                    do {
+                        /* if no callback is set, no need to read ?*/
+                        int read_amount = _ism.check_recv_status(socket->id, socket->read_data + socket->read_data_size, room);
+                        socket_account_read(socket, read_amount);
+                        full = (read_amount > 0) && ((uint32_t)read_amount + ES_WIFI_RX_TRAILER_SIZE >= room);
+                        if (read_amount > 0) {
+                            socket->read_data_size += read_amount;
+                            budget -= read_amount;
+                        } else if (read_amount < 0) {
+                            /* Mark donw connection has been lost or closed */
+                            socket->connected = false;
+                            socket_ready(socket);
+                            socket_notify(socket->id);
+                        }
+                        room = sizeof(socket->read_data) - socket->read_data_size;
+                        room = MIN(room, socket->rx_packet + ES_WIFI_RX_TRAILER_SIZE);
+                    } while (full && (room >= ISM43362_RX_MIN_READ) && (budget > 0));
+                    pending = pending || full;
+                } else if (reading) {
+                    /* out of budget, read at the next cycle */
+                    pending = true;
+                }
+                /* The module reads a closed connection as empty: sockets which
+                 * moved no data for a while are checked, unless their data waits
+                 * for the application, which reads them first */
+                if (socket->connected && !socket->rx_signaled && (socket->proto == NSAPI_TCP)
+                        && !socket->listening && socket_check_alive(socket)) {
+                    socket_ready(socket);
+                    socket_notify(socket->id);
+                }
+                if (!socket->rx_signaled && socket_rx_due(socket)) {
+                    /* There is something to read in this socket*/
+                    socket->rx_signaled = true;
+                    socket_ready(socket);
+                    socket_notify(socket->id);
+                }
+                if (socket->connected && (socket->tx_count > 0)) {
+                    socket_tx_drain(socket);
+                }
+                if (socket->connected && socket->keepalive_dirty) {
+                    socket_apply_options(socket);
+                }
+            }
+            unlock();
+            /* Callbacks run without the lock, so that they can use the socket */
+            notify_dispatch();
+        }
+        lock();
+        pool_expire();
+        unlock();
+        if (rssi_sample()) {
+            roaming_check();
+        }
+        recovery_check();
+        if (_connecting.async && (_connecting.state != CONNECT_IDLE)) {
+            connect_step();
+        }
+        /* Come back at once for the data left in the module */
+        wait_ms(pending ? 1 : 50);
+    }
+}
+
+bool ISM43362Interface::rssi_sample()
+{
+    ATTRACE_SCOPE("rssi_sample");
+    if ((_rssi.sample_period == 0) || !_connected) {
+        return false;
+    }
+
+    int now = _timer.read_ms();
+    if ((uint32_t)(now - _rssi.last_sample) < _rssi.sample_period) {
+        return false;
+    }
+
+    /* Only sample in between data transactions: retry on next loop if busy */
+    if (!_mutex.trylock()) {
+        return false;
+    }
+    _rssi.last_sample = now;
+
+    int8_t rssi;
+    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+    if (!_ism.getRSSI(rssi)) {
+        _rssi.stats.errors++;
+        unlock();
+        return false;
+    }
+
+    if (_rssi.stats.samples == 0) {
+        _rssi.average_x16 = rssi * 16;
+        _rssi.stats.min = rssi;
+        _rssi.stats.max = rssi;
+    } else {
+        /* Exponential moving average over ~8 samples */
+        _rssi.average_x16 += (rssi * 16 - _rssi.average_x16) / 8;
+        _rssi.stats.min = MIN(_rssi.stats.min, rssi);
+        _rssi.stats.max = MAX(_rssi.stats.max, rssi);
+    }
+    _rssi.stats.last = rssi;
+    _rssi.stats.average = _rssi.average_x16 / 16;
+    _rssi.stats.samples++;
+    _rssi.stats.timestamp = now;
+    unlock();
+
+    return true;
+}
+
+void ISM43362Interface::roaming_check()
+{
+    lock();
+    int8_t threshold = _roaming.threshold;
+    uint8_t hysteresis = _roaming.hysteresis;
+    int8_t rssi = _rssi.stats.average;
+    unlock();
+
+    if ((threshold == 0) || !_connected) {
+        return;
+    }
+
+    if (rssi >= threshold) {
+        return;
+    }
+
+    int now = _timer.read_ms();
+    if ((now - _roaming.last_scan) < ISM43362_ROAMING_SCAN_INTERVAL) {
+        return;
+    }
+    _roaming.last_scan = now;
+
+    WiFiAccessPoint *res = new WiFiAccessPoint[ISM43362_ROAMING_SCAN_COUNT];
+    uint8_t bssid[6];
+
+    lock();
+    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+    bool known = _ism.getBSSID(bssid);
+    busy_begin();
+    unlock();
+
+    /* The scan takes seconds: it runs without the lock, the module accesses
+     * of the other threads waiting for it in lock() */
+    _ism.setTimeout(ISM43362_CONNECT_TIMEOUT);
+    int count = _ism.scan(res, ISM43362_ROAMING_SCAN_COUNT);
+    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+
+    lock(false);
+    bool deferred = busy_end();
+    unlock();
+    if (deferred) {
+        event();
+    }
+
+    /* The current access point is compared with the others in the same scan,
+     * or with the RSSI average if it is not found */
+    int current = rssi;
+    int best = INT8_MIN;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(res[i].get_ssid(), ap_ssid) != 0) {
+            continue;
+        }
+        if (known && (memcmp(res[i].get_bssid(), bssid, sizeof(bssid)) == 0)) {
+            current = res[i].get_rssi();
+        } else if (res[i].get_rssi() > best) {
+            best = res[i].get_rssi();
+        }
+    }
+    delete[] res;
+
+    debug_if(ism_debug, "ISM43362: roaming rssi=%d best=%d\r\n", current, best);
+
+    /* only switch for a strictly stronger access point */
+    if (best > current + hysteresis) {
+        roam();
+    }
+}
+
+/*  Reconnect to the AP network: the module joins the strongest access point
+ *  it finds for the configured SSID. Socket I/O is paused by holding the
+ *  lock during the switch, except for the new connection done when the
+ *  rejoin fails. The roaming callback is called without the lock */
+void ISM43362Interface::roam()
+{
+    ATTRACE_SCOPE("roam");
+    lock();
+    Callback<void(bool)> cb = _roaming.cb;
+    unlock();
+
+    if (cb) {
+        cb(true);
+    }
+    set_status(NSAPI_STATUS_CONNECTING);
+
+    lock();
+    debug_if(ism_debug, "ISM43362: roaming to a stronger access point\r\n");
+    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+    _ism.disconnect();
+
+    _ism.setTimeout(ISM43362_CONNECT_TIMEOUT);
+    _connected = _ism.connect(ap_ssid, ap_pass);
+    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+    if (_connected) {
+        _connected = (_ism.getIPAddress() != 0);
+    }
+    bool rejoined = _connected;
+    if (!rejoined) {
+        _connecting.state = CONNECT_VERSION;
+        _connecting.cancel = 0;
+        _connecting.async = false;
+    }
+    unlock();
+
+    /* A failed rejoin is followed by a whole new connection, which reports
+     * the status */
+    if (!rejoined) {
+        debug_if(ism_debug, "ISM43362: roaming rejoin failed, reconnecting\r\n");
+        int ret;
+        do {
+            ret = connect_step();
+        } while (ret == NSAPI_ERROR_IN_PROGRESS);
+    }
+
+    lock();
+    /* Module connections do not survive the switch: they are closed, and
+     * the servers are restarted on the new network */
+    for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
+        if (_pool.entries[i].idle) {
+            pool_drop(i);
+        }
+        if (_socket_obj[i] != 0) {
+            struct ISM43362_socket *socket = (struct ISM43362_socket *)_socket_obj[i];
+            if (socket->listening || socket->accepted) {
+                struct ISM43362_socket *server = socket->listening ? socket : socket->server;
+                _ism.close_server(i);
+                if (server) {
+                    _ism.open_server("0", i, server->local_port);
+                }
+            } else if (socket->connected) {
+                _ism.close(i);
+            }
+            socket->connected = false;
+        }
+    }
+    unlock();
+
+    if (rejoined) {
+        set_status(NSAPI_STATUS_GLOBAL_UP);
+    }
+    if (cb) {
+        cb(false);
+    }
+
+    event();
+}
+
+int ISM43362Interface::set_recovery(uint8_t failure_threshold)
+{
+    lock();
+    _recovery.threshold = failure_threshold;
+    unlock();
+
+    return 0;
+}
+
+int ISM43362Interface::set_timeout_policy(uint8_t percent, uint8_t multiple, uint32_t floor_ms, uint32_t ceiling_ms)
+{
+    if ((percent > 100) || (multiple == 0) || (floor_ms > ceiling_ms)) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    lock();
+    _ism.set_timeout_policy(percent, multiple, floor_ms, ceiling_ms);
+    unlock();
+
+    return 0;
+}
+
+void ISM43362Interface::get_recovery_stats(ism43362_recovery_stats_t *stats)
+{
+    lock();
+    *stats = _recovery.stats;
+    unlock();
+}
+
+void ISM43362Interface::recovery_check()
+{
+    if ((_recovery.threshold == 0) || (_ism.transfer_failures() < _recovery.threshold)) {
+        return;
+    }
+
+    int now = _timer.read_ms();
+    if ((now - _recovery.last_attempt) < ISM43362_RECOVERY_INTERVAL) {
+        return;
+    }
+    _recovery.last_attempt = now;
+
+    recover();
+}
+
+/*  Reset the module and restore the network connection and the sockets.
+ *  The reset runs without the lock, which is also released between each
+ *  connection step and the socket restore, so that other threads are not
+ *  held for the whole time: in between, the sockets report their connection
+ *  lost. A connection in progress is cancelled, its caller gets
+ *  NSAPI_ERROR_DEVICE_ERROR, and only an established one is redone here */
+void ISM43362Interface::recover()
+{
+    ATTRACE_SCOPE("recover");
+    uint32_t start = us_ticker_read();
+
+    lock();
+    bool was_connected = _connected;
+    debug_if(ism_debug, "ISM43362: module not answering, reset\r\n");
+    _connected = false;
+    if (_connecting.state != CONNECT_IDLE) {
+        _connecting.cancel = NSAPI_ERROR_DEVICE_ERROR;
+    }
+
+    for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
+        /* Idle connections are gone with the reset */
+        if (_pool.entries[i].idle) {
+            _pool.entries[i].idle = false;
+            _ids[i] = false;
+        }
+        if (_socket_obj[i] == 0) {
+            continue;
+        }
+
+        struct ISM43362_socket *socket = (struct ISM43362_socket *)_socket_obj[i];
+        if (socket->accepted && socket->server) {
+            /* The accepted connection is lost, its server listens again */
+            socket->server->accept_pending = false;
+            socket->server->recovering = true;
+        } else if (socket->listening) {
+            socket->accept_pending = false;
+            socket->recovering = true;
+        } else if (socket->connected && !socket->accepted) {
+            socket->recovering = true;
+        }
+        if (socket->connected) {
+            socket->connected = false;
+            if (!socket->recovering) {
+                _recovery.stats.sockets_lost++;
+            }
+        }
+    }
+
+    busy_begin();
+    unlock();
+
+    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+    bool ok = _ism.reset();
+
+    lock(false);
+    busy_end();
+    bool reconnect = false;
+    if (ok && was_connected && (_connecting.state == CONNECT_IDLE)) {
+        _connecting.state = CONNECT_VERSION;
+        _connecting.cancel = 0;
+        _connecting.async = false;
+        reconnect = true;
+    }
+    unlock();
+
+    /* connect_step() reports the end of the reconnection */
+    if (was_connected) {
+        set_status(reconnect ? NSAPI_STATUS_CONNECTING : NSAPI_STATUS_DISCONNECTED);
+    }
+
+    if (reconnect) {
+        int ret;
+        do {
+            ret = connect_step();
+        } while (ret == NSAPI_ERROR_IN_PROGRESS);
+        ok = (ret == NSAPI_ERROR_OK);
+    }
+
+    lock();
+    for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
+        if (_socket_obj[i] == 0) {
+            continue;
+        }
+
+        struct ISM43362_socket *socket = (struct ISM43362_socket *)_socket_obj[i];
+        struct ISM43362_socket *server = (socket->accepted && socket->server) ? socket->server : socket;
+        if (!server->recovering) {
+            continue;
+        }
+        server->recovering = false;
+
+        bool restored = false;
+        if (ok && _connected && server->listening) {
+            restored = _ism.open_server("0", server->id, server->local_port);
+        } else if (ok && _connected) {
+            const char *proto = (server->proto == NSAPI_UDP) ? "1" : (server->tls ? "3" : "0");
+            _ism.setTimeout(ISM43362_CONNECT_TIMEOUT);
+            restored = _ism.open(proto, server->id, server->addr.get_ip_address(), server->addr.get_port());
+            _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+            server->keepalive_dirty = (server->keepalive != 0);
+            server->connected = restored;
+        }
+
+        if (restored) {
+            _recovery.stats.sockets_restored++;
+        } else {
+            _recovery.stats.sockets_lost++;
+        }
+    }
+
+    uint32_t elapsed = (us_ticker_read() - start) / 1000;
+    _recovery.stats.recoveries++;
+    if (!ok) {
+        _recovery.stats.failures++;
+    }
+    _recovery.stats.last_ms = elapsed;
+    _recovery.stats.total_ms += elapsed;
+    _recovery.stats.max_ms = MAX(_recovery.stats.max_ms, elapsed);
+    debug_if(ism_debug, "ISM43362: recovery %s in %lu ms\r\n", ok ? "done" : "failed", (unsigned long)elapsed);
+    unlock();
+
+    event();
+}
+
+/*  Connections are discovered by the socket read thread, which signals the
+ *  server socket callback */
+int ISM43362Interface::socket_accept(void *server, void **socket, SocketAddress *addr)
+{
+    lock();
+    struct ISM43362_socket *server_socket = (struct ISM43362_socket *)server;
+
+    if (!server_socket->listening) {
+        unlock();
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    if (!server_socket->accept_pending) {
+        unlock();
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+
+    struct ISM43362_socket *client = new struct ISM43362_socket;
+    if (!client) {
+        unlock();
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+    socket_init(client, server_socket->id, NSAPI_TCP);
+    debug_if(ism_debug, "socket_accept, id=%d", client->id);
+    client->addr = server_socket->accept_addr;
+    client->accepted = true;
+    client->server = server_socket;
+    client->connected = true;
+    server_socket->client = client;
+    server_socket->accept_pending = false;
+
+    /* the accepted connection is now the one polled for this module socket */
+    _socket_obj[client->id] = (uintptr_t)client;
+
+    if (addr) {
+        *addr = client->addr;
+    }
+    *socket = client;
+    unlock();
+
+    return 0;
+}
+
+int ISM43362Interface::socket_send(void *handle, const void *data, unsigned size)
+{
+    ATTRACE_SCOPE("socket_send");
+    lock(false);
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+    int ret;
+    if (socket->tx_queue) {
+        ret = socket_tx_queue(socket, data, size);
+    } else if (_busy.active) {
+        /* signaled again once the module is available */
+        _busy.deferred = true;
+        SOCKET_STAT_ADD(socket, would_block, 1);
+        ret = NSAPI_ERROR_WOULD_BLOCK;
+    } else {
+        ret = socket_send_nolock(handle, data, size);
+    }
+    unlock();
+    return ret;
+}
+
+/*  Check the connection of a socket idle for ISM43362_LIVENESS_INTERVAL,
+ *  lock must be taken
+ *  @return true if the connection was found closed, its remaining data
+ *  being then buffered */
+bool ISM43362Interface::socket_check_alive(void *handle)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+
+    int now = _timer.read_ms();
+    if ((now - socket->live_check) < ISM43362_LIVENESS_INTERVAL) {
+        return false;
+    }
+    socket->live_check = now;
+
+    _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+    if (_ism.socket_status(socket->id) != 0) {
+        /* errors are left to the data path */
+        return false;
+    }
+
+    /* The module keeps the data received before the close, read it all
+     * before the socket reports its connection lost */
+    int read_amount;
+    _ism.setTimeout(socket->recv_timeout);
+    do {
+        uint32_t room = sizeof(socket->read_data) - socket->read_data_size;
+        room = MIN(room, socket->rx_packet + ES_WIFI_RX_TRAILER_SIZE);
+        if (room < ISM43362_RX_MIN_READ) {
+            /* checked again once the application made room */
+            return false;
+        }
+        read_amount = _ism.check_recv_status(socket->id, socket->read_data + socket->read_data_size, room);
+        socket_account_read(socket, read_amount);
+        if (read_amount > 0) {
+            socket->read_data_size += read_amount;
+        }
+    } while (read_amount > 0);
+
+    debug_if(ism_debug, "socket id=%d: connection closed\r\n", socket->id);
+    socket->connected = false;
+    if (read_amount == 0) {
+        /* read errors are already accounted */
+        SOCKET_STAT_ADD(socket, recv_errors, 1);
+    }
+    return true;
+}
+
+/*  Send the socket settings that are not applied by the module accesses
+ *  themselves, lock must be taken */
+void ISM43362Interface::socket_apply_options(void *handle)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+
+    if (socket->keepalive_dirty) {
+        _ism.setTimeout(ISM43362_MISC_TIMEOUT);
+        if (_ism.set_keepalive(socket->id, socket->keepalive)) {
+            socket->keepalive_dirty = false;
+        } else {
+            debug_if(ism_debug, "socket id=%d: keep alive not set\r\n", socket->id);
+        }
+    }
+}
+
+/*  Copy data into the transmit queue of a socket, lock must be taken */
+int ISM43362Interface::socket_tx_queue(void *handle, const void *data, unsigned size)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+
+    if (socket->tx_error) {
+        int err = socket->tx_error;
+        socket->tx_error = 0;
+        return err;
+    }
+    if (!socket->connected) {
+        return NSAPI_ERROR_NO_CONNECTION;
+    }
+
+    uint32_t room = socket->tx_size - socket->tx_count;
+    if (room == 0) {
+        socket->tx_full = true;
+        SOCKET_STAT_ADD(socket, would_block, 1);
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+
+    uint32_t amount = MIN(size, room);
+    uint32_t tail = (socket->tx_head + socket->tx_count) % socket->tx_size;
+    uint32_t first = MIN(amount, socket->tx_size - tail);
+    memcpy(socket->tx_queue + tail, data, first);
+    memcpy(socket->tx_queue, (const char *)data + first, amount - first);
+    socket->tx_count += amount;
+
+    return amount;
+}
+
+/*  Send the transmit queue of a socket to the module, lock must be taken */
+void ISM43362Interface::socket_tx_drain(void *handle)
+{
+    ATTRACE_SCOPE("tx_drain");
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+    bool drained = false;
+
+    while (socket->tx_count > 0) {
+        uint32_t chunk = MIN(socket->tx_count, socket->tx_size - socket->tx_head);
+        int ret = socket_send_nolock(socket, socket->tx_queue + socket->tx_head, chunk);
+        if (ret < 0) {
+            /* The queued data is lost, the application learns it at the next send */
+            socket->tx_error = ret;
+            socket->tx_count = 0;
+            drained = true;
+            break;
+        }
+        socket->tx_head = (socket->tx_head + ret) % socket->tx_size;
+        socket->tx_count -= ret;
+        drained = true;
+    }
+
+    if (drained && (socket->tx_full || socket->tx_error)) {
+        socket->tx_full = false;
+        socket_ready(socket);
+        socket_notify(socket->id);
+    }
+}
+
+/*  Resize the transmit queue of a socket, lock must be taken */
+int ISM43362Interface::socket_tx_resize(void *handle, int size)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+
+    if (socket->tx_count > 0) {
+        return NSAPI_ERROR_BUSY;
+    }
+
+    delete[] socket->tx_queue;
+    socket->tx_queue = (size > 0) ? new char[size] : NULL;
+    socket->tx_size = size;
+    socket->tx_head = 0;
+    socket->tx_full = false;
+    socket->tx_error = 0;
+
+    return NSAPI_ERROR_OK;
+}
+
+/*  CAREFULL LOCK must be taken before callling this function */
+int ISM43362Interface::socket_send_nolock(void *handle, const void *data, unsigned size)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+    _ism.setTimeout(socket->send_timeout);
+
+    if (size > ES_WIFI_MAX_RX_PACKET_SIZE) {
         size = ES_WIFI_MAX_RX_PACKET_SIZE;
     }
 
     if (!_ism.send(socket->id, data, size)) {
         debug_if(ism_debug, "socket_send ERROR\r\n");
+        SOCKET_STAT_ADD(socket, send_errors, 1);
         return NSAPI_ERROR_DEVICE_ERROR; // or WOULD_BLOCK ?
     }
 
+    SOCKET_STAT_ADD(socket, bytes_sent, size);
+    socket->live_check = _timer.read_ms();
     return size;
 }
 
 int ISM43362Interface::socket_recv(void *handle, void *data, unsigned size)
 {
-    _mutex.lock();
+    ATTRACE_SCOPE("socket_recv");
+    lock(false);
     unsigned recv = 0;
     struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
     char *ptr = (char *)data;
 
     debug_if(ism_debug, "[socket_recv] req=%d\r\n", size);
 
-    if (!socket->connected) {
-        _mutex.unlock();
+    /* Data accumulated before the connection was lost can still be read */
+    if (!socket->connected && (socket->read_data_size == 0)) {
+        unlock();
         return NSAPI_ERROR_CONNECTION_LOST;
     }
 
-    _ism.setTimeout(ISM43362_RECV_TIMEOUT);
+    /* The buffered data can be read while the module is busy, not the module */
+    if ((socket->read_data_size == 0) && _busy.active) {
+        _busy.deferred = true;
+        SOCKET_STAT_ADD(socket, would_block, 1);
+        unlock();
+        return NSAPI_ERROR_WOULD_BLOCK;
+    }
+
+    _ism.setTimeout(socket->recv_timeout);
 
     if (socket->read_data_size == 0) {
         /* if no callback is set, no need to read ?*/
-        int read_amount = _ism.check_recv_status(socket->id, socket->read_data);
+        int read_amount = _ism.check_recv_status(socket->id, socket->read_data, socket->rx_packet + ES_WIFI_RX_TRAILER_SIZE);
+        socket_account_read(socket, read_amount);
         if (read_amount > 0) {
             socket->read_data_size = read_amount;
         } else if (read_amount < 0) {
             socket->connected = false;
-            _mutex.unlock();
+            unlock();
             return NSAPI_ERROR_CONNECTION_LOST;
         }
     }
 
     if (socket->read_data_size != 0) {
+        if (socket->data_timed) {
+            uint32_t latency = us_ticker_read() - socket->data_time;
+            SOCKET_STAT_ADD(socket, latency_samples, 1);
+            SOCKET_STAT_ADD(socket, latency_total_us, latency);
+            socket->stats.latency_max_us = MAX(socket->stats.latency_max_us, latency);
+            _stats.sockets.latency_max_us = MAX(_stats.sockets.latency_max_us, latency);
+            socket->data_timed = false;
+        }
+
         debug_if(ism_debug, "read_data_size=%d\r\n", socket->read_data_size);
         uint32_t i=0;
         while ((i < socket->read_data_size) && (i < size)) {
@@ -380,11 +1756,13 @@ int ISM43362Interface::socket_recv(void *handle, void *data, unsigned size)
 
         debug_if(ism_debug, "Copied i bytes=%d, vs %d requestd\r\n", i, size);
         recv += i;
+        SOCKET_STAT_ADD(socket, bytes_received, i);
 
         if (i >= socket->read_data_size) {
             /* All the storeed data has been read, reset buffer */
             memset(socket->read_data, 0, sizeof(socket->read_data));
             socket->read_data_size = 0;
+            socket->rx_signaled = false;
             debug_if(ism_debug, "Socket_recv buffer reset\r\n");
         } else {
             /*  In case there is remaining data in buffer, update socket content
@@ -402,7 +1780,10 @@ int ISM43362Interface::socket_recv(void *handle, void *data, unsigned size)
     }
 
     debug_if(ism_debug, "[socket_recv]read_datasize=%d, recv=%d\r\n", socket->read_data_size, recv);
-    _mutex.unlock();
+    if (recv == 0) {
+        SOCKET_STAT_ADD(socket, would_block, 1);
+    }
+    unlock();
 
     if (recv > 0) {
         return recv;
@@ -414,14 +1795,15 @@ int ISM43362Interface::socket_recv(void *handle, void *data, unsigned size)
 
 int ISM43362Interface::socket_sendto(void *handle, const SocketAddress &addr, const void *data, unsigned size)
 {
-    _mutex.lock();
+    ATTRACE_SCOPE("socket_sendto");
+    lock();
     struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
 
     if (socket->connected && socket->addr != addr) {
         _ism.setTimeout(ISM43362_MISC_TIMEOUT);
         if (!_ism.close(socket->id)) {
             debug_if(ism_debug, "socket_send ERROR\r\n");
-            _mutex.unlock();
+            unlock();
             return NSAPI_ERROR_DEVICE_ERROR;
         }
         socket->connected = false;
@@ -432,7 +1814,7 @@ int ISM43362Interface::socket_sendto(void *handle, const SocketAddress &addr, co
     if (!socket->connected) {
         int err = socket_connect_nolock(socket, addr);
         if (err < 0) {
-            _mutex.unlock();
+            unlock();
             return err;
         }
         socket->addr = addr;
@@ -440,7 +1822,7 @@ int ISM43362Interface::socket_sendto(void *handle, const SocketAddress &addr, co
 
     int ret = socket_send_nolock(socket, data, size);
 
-    _mutex.unlock();
+    unlock();
 
     return ret;
 }
@@ -448,28 +1830,477 @@ int ISM43362Interface::socket_sendto(void *handle, const SocketAddress &addr, co
 int ISM43362Interface::socket_recvfrom(void *handle, SocketAddress *addr, void *data, unsigned size)
 {
     int ret = socket_recv(handle, data, size);
-    _mutex.lock();
+    lock(false);
     if ((ret >= 0) && addr) {
         struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
         *addr = socket->addr;
     }
-    _mutex.unlock();
+    unlock();
     return ret;
 }
 
+/*  The standard options are implemented by the ISM43362 ones */
+nsapi_error_t ISM43362Interface::setsockopt(nsapi_socket_t handle, int level, int optname, const void *optval, unsigned optlen)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+
+    if (level == NSAPI_SOCKET) {
+        int period;
+        switch (optname) {
+            case NSAPI_KEEPALIVE:
+                if (optlen != sizeof(int)) {
+                    return NSAPI_ERROR_PARAMETER;
+                }
+                period = (*(const int *)optval != 0) ? socket->keepidle : 0;
+                return setsockopt(handle, ISM43362_SOCKET_LEVEL, ISM43362_KEEPALIVE, &period, sizeof(period));
+            case NSAPI_KEEPIDLE:
+                if ((optlen != sizeof(int)) || (*(const int *)optval <= 0)) {
+                    return NSAPI_ERROR_PARAMETER;
+                }
+                if (socket->keepalive == 0) {
+                    lock();
+                    socket->keepidle = *(const int *)optval;
+                    unlock();
+                    return NSAPI_ERROR_OK;
+                }
+                return setsockopt(handle, ISM43362_SOCKET_LEVEL, ISM43362_KEEPALIVE, optval, optlen);
+            case NSAPI_SNDBUF:
+                return setsockopt(handle, ISM43362_SOCKET_LEVEL, ISM43362_SNDBUF, optval, optlen);
+            case NSAPI_RCVBUF:
+                return setsockopt(handle, ISM43362_SOCKET_LEVEL, ISM43362_RCVPACKET, optval, optlen);
+            default:
+                return NSAPI_ERROR_UNSUPPORTED;
+        }
+    }
+
+    if (level != ISM43362_SOCKET_LEVEL) {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+
+    switch (optname) {
+        case ISM43362_STATS:
+            lock();
+            memset(&socket->stats, 0, sizeof(socket->stats));
+            unlock();
+            return NSAPI_ERROR_OK;
+        case ISM43362_TLS:
+            if (optlen != sizeof(int)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            if ((socket->proto != NSAPI_TCP) || socket->connected) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            lock();
+            socket->tls = (*(const int *)optval != 0);
+            unlock();
+            return NSAPI_ERROR_OK;
+        case ISM43362_RCVLOWAT:
+        case ISM43362_RCVLOWAT_TIMEOUT:
+            if (optlen != sizeof(int)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            if (socket->proto != NSAPI_TCP) {
+                /* datagrams are not merged */
+                return NSAPI_ERROR_UNSUPPORTED;
+            }
+            if ((*(const int *)optval < 0)
+                    || ((optname == ISM43362_RCVLOWAT) && (*(const int *)optval > (int)sizeof(socket->read_data)))) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            lock();
+            if (optname == ISM43362_RCVLOWAT) {
+                socket->rcvlowat = MAX(*(const int *)optval, 1);
+            } else {
+                socket->rcvlowat_ms = *(const int *)optval;
+            }
+            unlock();
+            return NSAPI_ERROR_OK;
+        case ISM43362_SNDBUF: {
+            if (optlen != sizeof(int)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            if (socket->proto != NSAPI_TCP) {
+                return NSAPI_ERROR_UNSUPPORTED;
+            }
+            int size = *(const int *)optval;
+            if ((size < 0) || (size > ISM43362_TX_QUEUE_MAX)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            lock();
+            nsapi_error_t err = socket_tx_resize(socket, size);
+            unlock();
+            return err;
+        }
+        case ISM43362_RCVADAPT:
+            if (optlen != sizeof(int)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            lock();
+            socket->rx_adaptive = (*(const int *)optval != 0);
+            unlock();
+            return NSAPI_ERROR_OK;
+        case ISM43362_RCVPACKET:
+        case ISM43362_RCVTIMEO:
+        case ISM43362_SNDTIMEO:
+        case ISM43362_KEEPALIVE: {
+            if (optlen != sizeof(int)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            int value = *(const int *)optval;
+            if ((value < 0) || ((optname != ISM43362_KEEPALIVE) && (value == 0))
+                    || ((optname == ISM43362_RCVPACKET) && (value > ES_WIFI_MAX_RX_PACKET_SIZE))) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            if ((optname == ISM43362_KEEPALIVE) && (socket->proto != NSAPI_TCP)) {
+                return NSAPI_ERROR_UNSUPPORTED;
+            }
+            /* Settings are cached, and sent to the module with its next access */
+            lock();
+            switch (optname) {
+                case ISM43362_RCVPACKET:
+                    socket->rx_packet = value;
+                    socket->rx_adaptive = false;
+                    break;
+                case ISM43362_RCVTIMEO:
+                    socket->recv_timeout = value;
+                    socket->rx_adaptive = false;
+                    break;
+                case ISM43362_SNDTIMEO:
+                    socket->send_timeout = value;
+                    break;
+                default:
+                    socket->keepalive_dirty = (socket->keepalive != value) || socket->keepalive_dirty;
+                    socket->keepalive = value;
+                    if (value > 0) {
+                        socket->keepidle = value;
+                    }
+                    break;
+            }
+            unlock();
+            return NSAPI_ERROR_OK;
+        }
+        default:
+            break;
+    }
+
+    return NSAPI_ERROR_UNSUPPORTED;
+}
+
+nsapi_error_t ISM43362Interface::getsockopt(nsapi_socket_t handle, int level, int optname, void *optval, unsigned *optlen)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+
+    if (level == NSAPI_SOCKET) {
+        switch (optname) {
+            case NSAPI_KEEPALIVE:
+            case NSAPI_KEEPIDLE:
+                if (*optlen < sizeof(int)) {
+                    return NSAPI_ERROR_PARAMETER;
+                }
+                *(int *)optval = (optname == NSAPI_KEEPALIVE) ? (socket->keepalive != 0) : socket->keepidle;
+                *optlen = sizeof(int);
+                return NSAPI_ERROR_OK;
+            case NSAPI_SNDBUF:
+                return getsockopt(handle, ISM43362_SOCKET_LEVEL, ISM43362_SNDBUF, optval, optlen);
+            case NSAPI_RCVBUF:
+                return getsockopt(handle, ISM43362_SOCKET_LEVEL, ISM43362_RCVPACKET, optval, optlen);
+            default:
+                return NSAPI_ERROR_UNSUPPORTED;
+        }
+    }
+
+    if (level != ISM43362_SOCKET_LEVEL) {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+
+    switch (optname) {
+        case ISM43362_TLS:
+            if (*optlen < sizeof(int)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            *(int *)optval = socket->tls ? 1 : 0;
+            *optlen = sizeof(int);
+            return NSAPI_ERROR_OK;
+        case ISM43362_STATS:
+            if (*optlen < sizeof(ism43362_socket_stats_t)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            lock();
+            memcpy(optval, &socket->stats, sizeof(ism43362_socket_stats_t));
+            unlock();
+            *optlen = sizeof(ism43362_socket_stats_t);
+            return NSAPI_ERROR_OK;
+        case ISM43362_HANDLE:
+            if (*optlen < sizeof(nsapi_socket_t)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            *(nsapi_socket_t *)optval = handle;
+            *optlen = sizeof(nsapi_socket_t);
+            return NSAPI_ERROR_OK;
+        case ISM43362_RCVLOWAT:
+        case ISM43362_RCVLOWAT_TIMEOUT:
+            if (*optlen < sizeof(int)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            *(int *)optval = (optname == ISM43362_RCVLOWAT) ? socket->rcvlowat : socket->rcvlowat_ms;
+            *optlen = sizeof(int);
+            return NSAPI_ERROR_OK;
+        case ISM43362_SNDBUF:
+            if (*optlen < sizeof(int)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            *(int *)optval = socket->tx_size;
+            *optlen = sizeof(int);
+            return NSAPI_ERROR_OK;
+        case ISM43362_RCVADAPT:
+            if (*optlen < sizeof(int)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            *(int *)optval = socket->rx_adaptive ? 1 : 0;
+            *optlen = sizeof(int);
+            return NSAPI_ERROR_OK;
+        case ISM43362_RCVPACKET:
+        case ISM43362_RCVTIMEO:
+        case ISM43362_SNDTIMEO:
+        case ISM43362_KEEPALIVE:
+            if (*optlen < sizeof(int)) {
+                return NSAPI_ERROR_PARAMETER;
+            }
+            *(int *)optval = (optname == ISM43362_RCVPACKET) ? socket->rx_packet
+                             : (optname == ISM43362_RCVTIMEO) ? socket->recv_timeout
+                             : (optname == ISM43362_SNDTIMEO) ? socket->send_timeout
+                             : socket->keepalive;
+            *optlen = sizeof(int);
+            return NSAPI_ERROR_OK;
+        default:
+            break;
+    }
+
+    return NSAPI_ERROR_UNSUPPORTED;
+}
+
+/*  Readiness of a socket, lock must be taken before calling it */
+uint8_t ISM43362Interface::socket_revents(void *handle, uint8_t events)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+    uint8_t revents = 0;
+
+    if (!socket) {
+        return ISM43362_POLLNVAL;
+    }
+    if (socket->rx_signaled || socket_rx_due(socket) || socket->accept_pending) {
+        revents |= ISM43362_POLLIN;
+    }
+    if (socket->connected) {
+        /* sends are written to the module synchronously, or queued */
+        if (!socket->tx_queue || (socket->tx_count < socket->tx_size)) {
+            revents |= ISM43362_POLLOUT;
+        }
+    } else if (!socket->listening && socket->addr) {
+        /* the socket was connected: let the application read the end of stream */
+        revents |= ISM43362_POLLHUP | ISM43362_POLLIN;
+    }
+
+    return revents & (events | ISM43362_POLLHUP);
+}
+
+/*  Wake up the thread waiting in poll if the socket is waited on */
+void ISM43362Interface::socket_ready(void *handle)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
+    if (socket->polled) {
+        _poll.flags.set(1);
+    }
+}
+
+int ISM43362Interface::poll(ism43362_pollfd_t *fds, unsigned count, int timeout_ms)
+{
+    if (!fds && count) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    lock();
+    if (_poll.waiting) {
+        unlock();
+        return NSAPI_ERROR_BUSY;
+    }
+    _poll.waiting = true;
+    for (unsigned i = 0; i < count; i++) {
+        if (fds[i].handle) {
+            ((struct ISM43362_socket *)fds[i].handle)->polled = true;
+        }
+    }
+    unlock();
+
+    int start = _timer.read_ms();
+    int ready;
+    while (1) {
+        /* clear before checking, so that a wake up during the check is not lost */
+        _poll.flags.clear(1);
+
+        lock();
+        ready = 0;
+        for (unsigned i = 0; i < count; i++) {
+            fds[i].revents = socket_revents(fds[i].handle, fds[i].events);
+            if (fds[i].revents) {
+                ready++;
+            }
+        }
+        unlock();
+
+        if (ready || (timeout_ms == 0)) {
+            break;
+        }
+        uint32_t wait = osWaitForever;
+        if (timeout_ms > 0) {
+            int elapsed = _timer.read_ms() - start;
+            if (elapsed >= timeout_ms) {
+                break;
+            }
+            wait = timeout_ms - elapsed;
+        }
+        _poll.flags.wait_any(1, wait);
+    }
+
+    lock();
+    for (unsigned i = 0; i < count; i++) {
+        if (fds[i].handle) {
+            ((struct ISM43362_socket *)fds[i].handle)->polled = false;
+        }
+    }
+    _poll.waiting = false;
+    unlock();
+
+    return ready;
+}
+
 void ISM43362Interface::socket_attach(void *handle, void (*cb)(void *), void *data)
 {
-    _mutex.lock();
+    lock();
     struct ISM43362_socket *socket = (struct ISM43362_socket *)handle;
-    _cbs[socket->id].callback = cb;
-    _cbs[socket->id].data = data;
-    _mutex.unlock();
+    socket->callback = cb;
+    socket->data = data;
+    unlock();
 }
 
+/*  Signal all the open sockets, the lock must not be taken */
 void ISM43362Interface::event() {
+    lock();
+    _poll.flags.set(1);
     for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
-        if (_cbs[i].callback) {
-            _cbs[i].callback(_cbs[i].data);
+        if (_socket_obj[i] != 0) {
+            socket_notify(i);
         }
     }
+    unlock();
+
+    notify_dispatch();
+}
+
+/*  Record an event for a socket, lock must be taken before calling it.
+ *  Events are coalesced until the callback is called by dispatch_pending */
+void ISM43362Interface::socket_notify(int id)
+{
+    struct ISM43362_socket *socket = (struct ISM43362_socket *)_socket_obj[id];
+    if (socket && socket->callback) {
+        _pending |= (1 << id);
+    }
+}
+
+/*  Call the callbacks of the pending events, or have the event queue call
+ *  them. The lock must not be taken */
+void ISM43362Interface::notify_dispatch()
+{
+    if (!_pending) {
+        return;
+    }
+
+    lock(false);
+    EventQueue *queue = _queue;
+    bool post = queue && _pending && !_dispatch_posted;
+    if (post) {
+        _dispatch_posted = true;
+    }
+    unlock();
+
+    /* Posted without the lock, the queue having its own. When the queue is
+     * full, the events stay pending until the next notification posts them */
+    if (post && (queue->call(this, &ISM43362Interface::dispatch_pending) == 0)) {
+        lock(false);
+        _dispatch_posted = false;
+        unlock();
+    }
+
+    if (!queue) {
+        dispatch_pending();
+    }
+}
+
+/*  Each callback is taken under the lock just before it is called, so that
+ *  a socket closed or detached meanwhile, e.g. by a previous callback, is
+ *  not called. A callback can still run while another thread detaches it:
+ *  Socket::close() detaches the callback before the socket is freed, but
+ *  the data of the callback must stay valid until the close returns */
+void ISM43362Interface::dispatch_pending()
+{
+    lock(false);
+    uint32_t pending = _pending;
+    _pending = 0;
+    _dispatch_posted = false;
+    unlock();
+
+    if (pending & ISM43362_STATUS_PENDING) {
+        dispatch_status();
+    }
+
+    for (int i = 0; i < ISM43362_SOCKET_COUNT; i++) {
+        if (!(pending & (1 << i))) {
+            continue;
+        }
+
+        lock();
+        struct ISM43362_socket *socket = (struct ISM43362_socket *)_socket_obj[i];
+        void (*callback)(void *) = socket ? socket->callback : 0;
+        void *data = socket ? socket->data : 0;
+        unlock();
+
+        if (callback) {
+            callback(data);
+        }
+    }
+}
+
+/*  Call the status callback for the queued status changes. A single thread
+ *  drains the queue, so that the changes are reported in order */
+void ISM43362Interface::dispatch_status()
+{
+    lock(false);
+    if (_status.dispatching) {
+        unlock();
+        return;
+    }
+    _status.dispatching = true;
+    while (_status.count > 0) {
+        nsapi_connection_status_t status = _status.queue[_status.head];
+        _status.head = (_status.head + 1) % ISM43362_STATUS_QUEUE_SIZE;
+        _status.count--;
+        Callback<void(nsapi_event_t, intptr_t)> cb = _status_cb;
+        unlock();
+
+        if (cb) {
+            cb(NSAPI_EVENT_CONNECTION_STATUS_CHANGE, status);
+        }
+
+        lock(false);
+    }
+    _status.dispatching = false;
+    unlock();
+}
+
+void ISM43362Interface::set_event_queue(EventQueue *queue)
+{
+    lock();
+    _queue = queue;
+    _dispatch_posted = false;
+    unlock();
 }
@@ -23,6 +23,111 @@
 
 #define ISM43362_SOCKET_COUNT 4
 
+// Connection status changes waiting for the status callback
+#define ISM43362_STATUS_QUEUE_SIZE 4
+
+/** Level of the ISM43362 specific socket options, see Socket::setsockopt
+ */
+#define ISM43362_SOCKET_LEVEL 7100
+
+/** Keep alive period enabled by NSAPI_KEEPALIVE before any NSAPI_KEEPIDLE */
+#define ISM43362_KEEPIDLE_DEFAULT 60000 /* milliseconds */
+
+/** ISM43362 specific socket options
+ */
+typedef enum {
+    ISM43362_TLS = 0,   /*!< Offload TLS to the module (int, 0 or 1), to be set before connecting a TCP socket */
+    ISM43362_STATS = 1, /*!< Socket statistics (ism43362_socket_stats_t), read only, setting it clears them */
+    ISM43362_HANDLE = 2, /*!< Handle of the socket (nsapi_socket_t), read only, to wait on it with ISM43362Interface::poll */
+    ISM43362_RCVLOWAT = 3, /*!< Bytes to buffer before signaling a TCP socket (int, default 1) */
+    ISM43362_RCVLOWAT_TIMEOUT = 4, /*!< Longest time data waits for ISM43362_RCVLOWAT, in milliseconds (int, default 0 for no limit) */
+    ISM43362_SNDBUF = 5, /*!< Size of the transmit queue of a TCP socket, in bytes (int, default 0 for synchronous sends) */
+    ISM43362_RCVPACKET = 6, /*!< Largest packet read from the module (R1), in bytes (int, 1 to ES_WIFI_MAX_RX_PACKET_SIZE) */
+    ISM43362_RCVTIMEO = 7, /*!< Module read timeout of socket_recv (R2), in milliseconds (int) */
+    ISM43362_SNDTIMEO = 8, /*!< Module write timeout (S2), in milliseconds (int) */
+    ISM43362_KEEPALIVE = 9, /*!< TCP keep alive period, in milliseconds (int, default 0 for none) */
+    ISM43362_RCVADAPT = 10, /*!< Adapt ISM43362_RCVPACKET and ISM43362_RCVTIMEO to the traffic (int, 0 or 1, default 1, cleared by setting them) */
+} ism43362_socket_option_t;
+
+/** Types of TLS credentials loaded into the module
+ */
+typedef enum {
+    ISM43362_TLS_ROOT_CA = 0,       /*!< Root CA certificate used to verify the server */
+    ISM43362_TLS_CLIENT_CERT = 1,   /*!< Client certificate */
+    ISM43362_TLS_CLIENT_KEY = 2,    /*!< Client private key */
+} ism43362_tls_credential_t;
+
+/** Link quality metrics maintained by the RSSI monitor
+ */
+typedef struct {
+    int8_t last;        /**< Last sampled RSSI in dBm */
+    int8_t average;     /**< Moving average of the RSSI in dBm */
+    int8_t min;         /**< Lowest sampled RSSI in dBm */
+    int8_t max;         /**< Highest sampled RSSI in dBm */
+    uint32_t samples;   /**< Number of successful samples */
+    uint32_t errors;    /**< Number of failed samples */
+    uint32_t timestamp; /**< Time of the last sample, in milliseconds since interface creation */
+} ism43362_rssi_stats_t;
+
+/** Statistics of the module recovery supervisor
+ */
+typedef struct {
+    uint32_t recoveries;        /**< Module resets done by the supervisor */
+    uint32_t failures;          /**< Recoveries that could not restore the network connection */
+    uint32_t sockets_restored;  /**< Sockets reopened after a reset */
+    uint32_t sockets_lost;      /**< Sockets reported as lost after a reset */
+    uint32_t last_ms;           /**< Duration of the last recovery */
+    uint32_t max_ms;            /**< Longest recovery */
+    uint32_t total_ms;          /**< Sum of the recovery durations */
+} ism43362_recovery_stats_t;
+
+/** Traffic statistics of a socket, or of all the sockets of the interface
+ *
+ *  There is no retry counter: the driver does not retry module commands,
+ *  failed ones are counted in send_errors, recv_errors and connect_errors,
+ *  and reconnections in ism43362_recovery_stats_t.
+ */
+typedef struct {
+    uint32_t bytes_sent;        /**< Bytes accepted by the module */
+    uint32_t bytes_received;    /**< Bytes returned to the application */
+    uint32_t polls;             /**< Module reads (R0) done to check for data */
+    uint32_t empty_polls;       /**< Module reads that returned no data */
+    uint32_t would_block;       /**< Receive calls that returned NSAPI_ERROR_WOULD_BLOCK */
+    uint32_t send_errors;       /**< Failed sends */
+    uint32_t recv_errors;       /**< Connections found lost or closed when reading */
+    uint32_t connect_errors;    /**< Failed connections */
+    uint32_t latency_samples;   /**< Number of poll to receive latency samples */
+    uint32_t latency_total_us;  /**< Sum of the times between data read from the module and handed to the application */
+    uint32_t latency_max_us;    /**< Longest time between data read from the module and handed to the application */
+    uint32_t rx_high_water;     /**< Largest amount of data buffered for a socket */
+} ism43362_socket_stats_t;
+
+/** Statistics of the interface
+ */
+typedef struct {
+    ism43362_socket_stats_t sockets;    /**< Sum of the statistics of all the sockets */
+    uint32_t lock_contentions;          /**< Times a caller blocked on the interface lock */
+    uint32_t lock_wait_us;              /**< Total time blocked on the interface lock */
+    uint32_t lock_wait_max_us;          /**< Longest time blocked on the interface lock */
+} ism43362_interface_stats_t;
+
+/** Socket readiness events, see ISM43362Interface::poll
+ */
+typedef enum {
+    ISM43362_POLLIN = 0x01,     /*!< Data is buffered, or a client connected to a server socket */
+    ISM43362_POLLOUT = 0x02,    /*!< Data can be sent */
+    ISM43362_POLLHUP = 0x04,    /*!< The connection was closed or lost, always reported */
+    ISM43362_POLLNVAL = 0x08,   /*!< Invalid socket handle, always reported */
+} ism43362_poll_event_t;
+
+/** Socket waited on by ISM43362Interface::poll
+ */
+typedef struct {
+    nsapi_socket_t handle;  /**< Socket handle, read with the ISM43362_HANDLE socket option */
+    uint8_t events;         /**< Requested ism43362_poll_event_t events */
+    uint8_t revents;        /**< Returned ism43362_poll_event_t events */
+} ism43362_pollfd_t;
+
 /** ISM43362Interface class
  *  Implementation of the NetworkStack for the ISM43362
  */
@@ -38,12 +143,44 @@ public:
      */
     ISM43362Interface(PinName mosi, PinName miso, PinName clk, PinName nss, PinName reset, PinName dataready, PinName wakeup, bool debug = false);
 
+    /** ISM43362Interface lifetime, for the UART variants of the module
+     * @param tx         UART transmit pin
+     * @param rx         UART receive pin
+     * @param reset      Reset pin
+     * @param wakeup     Wakeup pin
+     * @param debug      Enable debugging
+     */
+    ISM43362Interface(PinName tx, PinName rx, PinName reset, PinName wakeup, bool debug = false);
+
+    /** ISM43362Interface lifetime, on a given transport
+     * @param transport  Transport to the module, owned by the interface
+     * @param reset      Reset pin
+     * @param wakeup     Wakeup pin
+     * @param debug      Enable debugging
+     */
+    ISM43362Interface(ATTransport *transport, PinName reset, PinName wakeup, bool debug = false);
+
+    /** Stops the socket read thread before the module is released
+     */
+    virtual ~ISM43362Interface();
+
     /** Start the interface
      *
      *  Attempts to connect to a WiFi network. Requires ssid and passphrase to be set.
      *  If passphrase is invalid, NSAPI_ERROR_AUTH_ERROR is returned.
      *
-     *  @return         0 on success, negative error code on failure
+     *  In non-blocking mode, see set_blocking, the connection runs in the
+     *  background and its progress is reported through the status callback:
+     *  NSAPI_STATUS_CONNECTING, then NSAPI_STATUS_GLOBAL_UP or
+     *  NSAPI_STATUS_DISCONNECTED. disconnect() cancels it.
+     *
+     *  The status callback is also called when the interface reconnects by
+     *  itself, on roaming or after a module recovery.
+     *
+     *  @return         0 on success or once started in non-blocking mode,
+     *                  NSAPI_ERROR_BUSY if a connection is in progress,
+     *                  NSAPI_ERROR_IS_CONNECTED if already connected,
+     *                  negative error code on failure
      */
     virtual int connect();
 
@@ -93,11 +230,35 @@ public:
      */
     virtual int set_channel(uint8_t channel);
 
-    /** Stop the interface
+    /** Stop the interface, or cancel a connection in progress
      *  @return             0 on success, negative on failure
      */
     virtual int disconnect();
 
+    /** Register a callback for the connection status changes
+     *
+     *  The callback is called for each change, in order, like the socket
+     *  callbacks: by the thread that made the change or from the event queue
+     *  of set_event_queue, without the interface lock.
+     *
+     *  @param status_cb    Function called with NSAPI_EVENT_CONNECTION_STATUS_CHANGE
+     *                      and the new nsapi_connection_status_t
+     */
+    virtual void attach(Callback<void(nsapi_event_t, intptr_t)> status_cb);
+
+    /** Get the connection status
+     *
+     *  @return             Current nsapi_connection_status_t
+     */
+    virtual nsapi_connection_status_t get_connection_status() const;
+
+    /** Set blocking or non-blocking mode of connect
+     *
+     *  @param blocking     true for blocking mode (default), false for non-blocking mode
+     *  @return             0 on success
+     */
+    virtual nsapi_error_t set_blocking(bool blocking);
+
     /** Get the internally stored IP address
      *  @return             IP address of the interface or null if not yet connected
      */
@@ -124,10 +285,92 @@ public:
 
     /** Gets the current radio signal strength for active connection
      *
-     * @return          Connection strength in dBm (negative value)
+     * When the RSSI monitor is enabled, the last sampled value is returned
+     * without any access to the module.
+     *
+     * @return          Connection strength in dBm (negative value), 0 if unknown
      */
     virtual int8_t get_rssi();
 
+    /** Enable the RSSI monitor
+     *
+     *  The RSSI is sampled by the socket read thread in between data
+     *  transactions; a sample is skipped if the module is busy.
+     *
+     *  @param sample_period_ms  Period between two RSSI samples in milliseconds, 0 to disable the monitor
+     *  @return                  0 on success, negative error code on failure
+     */
+    int set_rssi_monitor(uint32_t sample_period_ms);
+
+    /** Get the link quality metrics of the RSSI monitor
+     *
+     *  @param stats     Destination for the metrics
+     *  @return          0 on success, NSAPI_ERROR_NO_CONNECTION if nothing was sampled yet
+     */
+    int get_rssi_stats(ism43362_rssi_stats_t *stats);
+
+    /** Reset the link quality metrics of the RSSI monitor
+     */
+    void reset_rssi_stats();
+
+    /** Record the SPI frames exchanged with the module
+     *
+     *  The recording can be exported with SpiRecorder::dump and played back
+     *  through the driver with SpiReplay.
+     *
+     *  @param recorder  Recorder to log into, NULL to stop recording
+     *  @return          0 on success, NSAPI_ERROR_UNSUPPORTED if the module is not connected through SPI
+     */
+    int record(SpiRecorder *recorder);
+
+    /** Inject faults in the module link, to measure the recovery time
+     *
+     *  @param faults    Fault injection link, see FaultTransport, NULL to remove it
+     */
+    void set_fault_injection(FaultTransport *faults);
+
+    /** Get the per command latency statistics
+     *
+     *  Collected only when the library is built with ATPARSER_PROFILE set to 1.
+     *  ATParser::percentile gives p50/p99 out of the histograms.
+     *
+     *  @param stats     Destination for the statistics, one entry per command prefix
+     *  @param count     Number of entries in stats
+     *  @return          Number of entries filled
+     */
+    int get_command_stats(at_command_stats_t *stats, int count);
+
+    /** Clear the per command latency statistics
+     */
+    void reset_command_stats();
+
+    /** Get the statistics of the interface
+     *
+     *  Statistics of a single socket are read with the ISM43362_STATS socket option.
+     *
+     *  @param stats     Destination for the statistics
+     */
+    void get_stats(ism43362_interface_stats_t *stats);
+
+    /** Reset the statistics of the interface
+     */
+    void reset_stats();
+
+    /** Wait until sockets are ready
+     *
+     *  Readiness is resolved from the data already buffered by the socket
+     *  read thread, which polls the module for the waited sockets, so no
+     *  module access is done by the caller. Only one thread at a time can
+     *  wait.
+     *
+     *  @param fds          Sockets to wait on, revents is set on return
+     *  @param count        Number of entries in fds
+     *  @param timeout_ms   Maximum time to wait, 0 to return at once, negative to wait forever
+     *  @return             Number of ready sockets, 0 on timeout,
+     *                      NSAPI_ERROR_BUSY if another thread is waiting
+     */
+    int poll(ism43362_pollfd_t *fds, unsigned count, int timeout_ms);
+
     /** Scan for available networks
      *
      * This function will block.
@@ -140,6 +383,115 @@ public:
      */
     virtual int scan(WiFiAccessPoint *res, unsigned count);
 
+    /** Load a TLS credential into the module
+     *
+     *  Credentials are used by the sockets for which the ISM43362_TLS
+     *  option is set, so that TLS runs on the module instead of the MCU.
+     *
+     *  @param type      Type of credential
+     *  @param pem       PEM encoded certificate or key, null-terminated
+     *  @return          0 on success, negative error code on failure
+     */
+    int set_tls_credential(ism43362_tls_credential_t type, const char *pem);
+
+    /** Keep closed TCP connections open for reuse
+     *
+     *  When enabled, closing a connected TCP socket keeps its module
+     *  connection open and idle. A socket later connecting to the same
+     *  address reuses it, after a short liveness check, instead of opening a
+     *  new connection. Idle connections are closed after @a idle_timeout_ms,
+     *  or least recently used first when a socket is opened while all module
+     *  sockets are in use.
+     *
+     *  @note Only suitable for protocols where a connection can carry
+     *        independent requests, e.g. HTTP keep-alive
+     *
+     *  @param enabled           true to keep connections open for reuse
+     *  @param idle_timeout_ms   Max idle time of a kept connection in milliseconds (Default: 30000)
+     *  @return                  0 on success, negative error code on failure
+     */
+    int set_connection_pool(bool enabled, uint32_t idle_timeout_ms = 30000);
+
+    /** Enable background roaming between access points sharing the same SSID
+     *
+     *  While connected, the RSSI monitor samples the link at a low rate. Once
+     *  its moving average falls below @a rssi_threshold, a background scan is
+     *  done and the interface reconnects if an access point with the same SSID
+     *  is more than @a hysteresis dB stronger than the current link.
+     *
+     *  @param rssi_threshold    RSSI in dBm below which roaming is considered, 0 to disable roaming
+     *  @param hysteresis        Minimum RSSI gain in dB required to switch access point (Default: 8)
+     *  @param sample_period_ms  RSSI monitor sampling period, see set_rssi_monitor (Default: 2000)
+     *  @return                  0 on success, negative error code on failure
+     */
+    int set_roaming(int8_t rssi_threshold, uint8_t hysteresis = 8, uint32_t sample_period_ms = 2000);
+
+    /** Register a callback called around an access point switch
+     *
+     *  The callback is called with true just before the switch, and with
+     *  false once the switch is over, from the socket read thread and
+     *  without the interface lock. Sockets which were connected before the
+     *  switch are closed and reported as lost, server sockets are restarted.
+     *
+     *  @param cb        Function to call, or 0 to set as none
+     */
+    void attach_roaming(Callback<void(bool)> cb);
+
+    /** Enable the module recovery supervisor
+     *
+     *  The socket read thread watches the module link. After a number of
+     *  consecutive transfers that get no answer, the module is reset with the
+     *  reset pin and, if the interface was connected, it reconnects to the
+     *  access point. Client sockets which were connected are reopened to the
+     *  same address, server sockets listen again, and the callbacks of all
+     *  sockets are called. Sockets that could not be reopened report
+     *  NSAPI_ERROR_CONNECTION_LOST, and data held by the module is lost.
+     *  Accepted connections are lost, their server listens again. A
+     *  connection in progress is cancelled and returns
+     *  NSAPI_ERROR_DEVICE_ERROR. The reset runs without the interface lock,
+     *  which is also released between each connection step and the
+     *  reopening of the sockets, so other calls can run meanwhile, the
+     *  sockets then reporting their connection lost.
+     *
+     *  @param failure_threshold Consecutive failed transfers that trigger a recovery, 0 to disable
+     *  @return                  0 on success, negative error code on failure
+     */
+    int set_recovery(uint8_t failure_threshold);
+
+    /** Adapt the timeouts to the observed module response times
+     *
+     *  By default the driver waits for a response up to the module timeout
+     *  of the operation plus a 5 s margin, so a stuck module stalls the
+     *  calling thread for seconds. With the policy enabled, once a command
+     *  got enough responses, its timeout becomes multiple times the given
+     *  percentile of its response times, bounded by floor_ms and ceiling_ms.
+     *  It is never shorter than the module timeout of the operation, so
+     *  only the margin is cut.
+     *
+     *  @param percent   Percentile of the response times, 1-100, 0 to disable
+     *  @param multiple  Factor applied to the percentile
+     *  @param floor_ms  Shortest timeout
+     *  @param ceiling_ms Longest timeout
+     *  @return          0 on success, negative error code on failure
+     */
+    int set_timeout_policy(uint8_t percent, uint8_t multiple = 4, uint32_t floor_ms = 100, uint32_t ceiling_ms = 20000);
+
+    /** Get the statistics of the module recovery supervisor
+     *
+     *  @param stats     Destination for the statistics
+     */
+    void get_recovery_stats(ism43362_recovery_stats_t *stats);
+
+    /** Call the socket callbacks from an event queue
+     *
+     *  Socket events are coalesced: a callback is called once for all the
+     *  events that happened since its last call. By default, callbacks are
+     *  called by the socket read thread, without the interface lock.
+     *
+     *  @param queue     Event queue to call the callbacks from, NULL for the socket read thread
+     */
+    void set_event_queue(EventQueue *queue);
+
     /** Translates a hostname to an IP address with specific version
      *
      *  The hostname may be either a domain name or an IP address. If the
@@ -254,6 +606,38 @@ protected:
      */
     virtual int socket_recvfrom(void *handle, SocketAddress *address, void *buffer, unsigned size);
 
+    /** Set a socket option
+     *
+     *  At the NSAPI_SOCKET level, NSAPI_KEEPALIVE enables ISM43362_KEEPALIVE
+     *  with the NSAPI_KEEPIDLE period, in milliseconds, NSAPI_SNDBUF is
+     *  ISM43362_SNDBUF and NSAPI_RCVBUF is ISM43362_RCVPACKET, the driver
+     *  buffer of a socket having a fixed size.
+     *
+     *  @param handle       Socket handle
+     *  @param level        Option level, ISM43362_SOCKET_LEVEL or NSAPI_SOCKET
+     *  @param optname      Option identifier, see ism43362_socket_option_t
+     *  @param optval       Option value
+     *  @param optlen       Length of the option value
+     *  @return             0 on success, negative on failure
+     */
+    virtual nsapi_error_t setsockopt(nsapi_socket_t handle, int level, int optname, const void *optval, unsigned optlen);
+
+    /** Get a socket option
+     *
+     *  At the NSAPI_SOCKET level, NSAPI_KEEPALIVE enables ISM43362_KEEPALIVE
+     *  with the NSAPI_KEEPIDLE period, in milliseconds, NSAPI_SNDBUF is
+     *  ISM43362_SNDBUF and NSAPI_RCVBUF is ISM43362_RCVPACKET, the driver
+     *  buffer of a socket having a fixed size.
+     *
+     *  @param handle       Socket handle
+     *  @param level        Option level, ISM43362_SOCKET_LEVEL or NSAPI_SOCKET
+     *  @param optname      Option identifier, see ism43362_socket_option_t
+     *  @param optval       Destination for the option value
+     *  @param optlen       Length of the option value
+     *  @return             0 on success, negative on failure
+     */
+    virtual nsapi_error_t getsockopt(nsapi_socket_t handle, int level, int optname, void *optval, unsigned *optlen);
+
     /** Register a callback on state change of the socket
      *  @param handle       Socket handle
      *  @param callback     Function to call on state change
@@ -274,26 +658,141 @@ protected:
 private:
     ISM43362 _ism;
     bool _ids[ISM43362_SOCKET_COUNT];
-    uint32_t _socket_obj[ISM43362_SOCKET_COUNT]; // store addresses of socket handles
+    uintptr_t _socket_obj[ISM43362_SOCKET_COUNT]; // store addresses of socket handles
     Mutex _mutex;
     Thread thread_read_socket;
     char ap_ssid[33]; /* 32 is what 802.11 defines as longest possible name; +1 for the \0 */
     nsapi_security_t ap_sec;
     uint8_t ap_ch;
     char ap_pass[64]; /* The longest allowed passphrase */
+    volatile bool _connected;
+    Timer _timer;
+
+    struct {
+        uint32_t sample_period;
+        int last_sample;
+        int average_x16; /* moving average, fixed point 1/16 dBm */
+        ism43362_rssi_stats_t stats;
+    } _rssi;
+
+    struct {
+        bool enabled;
+        uint32_t idle_timeout;
+        struct {
+            bool idle;
+            bool tls;
+            SocketAddress addr;
+            int released;
+            int keepalive;      /* keep alive period set in the module, -1 if unknown */
+        } entries[ISM43362_SOCKET_COUNT];
+    } _pool;
+
+    struct {
+        int8_t threshold;
+        uint8_t hysteresis;
+        int last_scan;
+        Callback<void(bool)> cb;
+    } _roaming;
+
+    /* A long module operation (scan, reset) run by the socket read thread
+     * without the lock */
+    struct {
+        volatile bool active;
+        bool deferred;           /* a socket call was refused meanwhile */
+        EventFlags done;
+    } _busy;
+
+    enum {
+        CONNECT_IDLE = 0,
+        CONNECT_VERSION,
+        CONNECT_DHCP,
+        CONNECT_JOIN,
+        CONNECT_IP
+    };
+    struct {
+        volatile int state;
+        volatile int cancel;     /* error reported by the next connection step, 0 if none */
+        bool async;
+    } _connecting;
+    bool _blocking;
+    volatile nsapi_connection_status_t _conn_status;
+    Callback<void(nsapi_event_t, intptr_t)> _status_cb;
 
+    struct {
+        uint8_t threshold;
+        int last_attempt;
+        ism43362_recovery_stats_t stats;
+    } _recovery;
+
+    ism43362_interface_stats_t _stats;
+
+    struct {
+        bool waiting;
+        EventFlags flags;
+    } _poll;
+
+    void init();
     void event();
+    void lock(bool module = true);
+    void unlock();
+    void busy_begin();
+    bool busy_end();
+    int connect_step();
+    void set_status(nsapi_connection_status_t status);
+    volatile uint32_t _pending; /* sockets with events not yet signaled to their callback */
     struct {
-        void (*callback)(void *);
-        void *data;
-    } _cbs[ISM43362_SOCKET_COUNT];
+        nsapi_connection_status_t queue[ISM43362_STATUS_QUEUE_SIZE];
+        int head;
+        int count;
+        bool dispatching;       /* a thread calls the status callback */
+    } _status;
+    EventQueue *_queue;
+    bool _dispatch_posted;
+    void socket_notify(int id);
+    void notify_dispatch();
+    void dispatch_pending();
+    void dispatch_status();
 
     /** Function called by the socket read thread to check if data is available on the wifi module
      *
      */
     virtual void socket_check_read();
     int socket_send_nolock(void *handle, const void *data, unsigned size);
+    int socket_tx_queue(void *handle, const void *data, unsigned size);
+    void socket_tx_drain(void *handle);
+    void socket_apply_options(void *handle);
+    bool socket_check_alive(void *handle);
+    int socket_tx_resize(void *handle, int size);
     int socket_connect_nolock(void *handle, const SocketAddress &addr);
+    void socket_account_read(void *handle, int read_amount);
+    bool socket_rx_due(void *handle);
+    void socket_rx_adapt(void *handle, int read_amount);
+    uint8_t socket_revents(void *handle, uint8_t events);
+    void socket_ready(void *handle);
+
+    /** Connection pool helpers, lock must be taken before calling them
+     *
+     */
+    bool pool_reuse(void *handle, const SocketAddress &addr);
+    void pool_drop(int id);
+    void pool_expire();
+
+    /** Function called by the socket read thread to sample RSSI
+     *  @return             true if a new sample was taken
+     */
+    bool rssi_sample();
+
+    /** Function called by the socket read thread to roam if needed
+     *
+     */
+    void roaming_check();
+    void roam();
+
+    /** Function called by the socket read thread to reset and restore the module if needed
+     *
+     */
+    void recovery_check();
+    void recover();
 
 };
 
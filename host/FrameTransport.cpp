@@ -0,0 +1,113 @@
+/**
+ * @file    FrameTransport.cpp
+ * @brief   Link to the wifi device answering from a table of frames
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameTransport.h"
+
+FrameTransport::FrameTransport(uint32_t buf_size)
+    : _buf_size(buf_size), _default("OK\r\n> "), _pending("> "), _has_pending(true), _rx_pos(0)
+{
+}
+
+void FrameTransport::set_response(const char *prefix, const std::string &frame)
+{
+    _responses[std::string(prefix, 2)] = frame;
+}
+
+void FrameTransport::set_default(const std::string &frame)
+{
+    _default = frame;
+}
+
+void FrameTransport::clear(void)
+{
+    _has_pending = false;
+    _rx.clear();
+    _rx_pos = 0;
+    _tx.clear();
+}
+
+void FrameTransport::command(const std::string &frame)
+{
+    std::map<std::string, std::string>::const_iterator it = _responses.find(frame.substr(0, 2));
+
+    _pending = (it != _responses.end()) ? it->second : _default;
+    _has_pending = true;
+}
+
+int FrameTransport::readable(void)
+{
+    return (_rx_pos < _rx.size()) ? 1 : 0;
+}
+
+int FrameTransport::getc(void)
+{
+    if (_rx_pos >= _rx.size()) {
+        return -1;
+    }
+    return (uint8_t)_rx[_rx_pos++];
+}
+
+int FrameTransport::putc(int c)
+{
+    _tx += (char)c;
+    return c;
+}
+
+ssize_t FrameTransport::buffwrite(const void *s, size_t length)
+{
+    _tx.clear();
+    command(std::string((const char *)s, length));
+    return length;
+}
+
+ssize_t FrameTransport::buffsend(size_t length)
+{
+    command(_tx);
+    _tx.clear();
+    return length;
+}
+
+ssize_t FrameTransport::read()
+{
+    /* No data ready edge without a command */
+    if (!_has_pending) {
+        return -1;
+    }
+    _has_pending = false;
+
+    /* Like BufferedSpi, a frame filling the buffer is an error */
+    if (_pending.size() >= _buf_size) {
+        return -1;
+    }
+
+    _rx.erase(0, _rx_pos);
+    _rx_pos = 0;
+    _rx.append(_pending);
+    return _pending.size();
+}
+
+void FrameTransport::setTimeout(int timeout)
+{
+}
+
+void FrameTransport::setGuard(int guard)
+{
+}
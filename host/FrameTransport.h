@@ -0,0 +1,92 @@
+/**
+ * @file    FrameTransport.h
+ * @brief   Link to the wifi device answering from a table of frames
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FRAMETRANSPORT_H
+#define FRAMETRANSPORT_H
+
+#include <map>
+#include <string>
+#include "mbed.h"
+#include "ATTransport.h"
+
+/**
+ *  @class FrameTransport
+ *  @brief Link answering each command with a fixed response frame
+ *
+ *  The response of a command is looked up by its first 2 characters, the
+ *  default response is used for the other commands. Frames are given as
+ *  stored in the receive buffer by BufferedSpi, that is without the leading
+ *  "\r\n" of the module. There is no SPI and no waiting, so only the parsing
+ *  of the responses is measured or exercised.
+ *
+ *  Example:
+ *  @code
+ *  FrameTransport *link = new FrameTransport();
+ *  link->set_response("CR", "-52\r\nOK\r\n> ");
+ *  ISM43362 wifi(link, NC, NC);
+ *  int8_t rssi = wifi.getRSSI();
+ *  @endcode
+ */
+class FrameTransport : public ATTransport
+{
+public:
+    /** Create a link, the first read returns the boot prompt
+     *  @param buf_size size of the receive buffer, larger frames fail like on SPI
+     */
+    FrameTransport(uint32_t buf_size = 1440);
+
+    /** Set the response of the commands starting with prefix
+     *  @param prefix first 2 characters of the command
+     *  @param frame response frame
+     */
+    void set_response(const char *prefix, const std::string &frame);
+
+    /** Set the response of the commands without their own one
+     *  @param frame response frame
+     */
+    void set_default(const std::string &frame);
+
+    /** Drop the pending response and the unread bytes
+     */
+    void clear(void);
+
+    virtual int readable(void);
+    virtual int getc(void);
+    virtual int putc(int c);
+    virtual ssize_t buffwrite(const void *s, size_t length);
+    virtual ssize_t buffsend(size_t length);
+    virtual ssize_t read();
+    virtual void setTimeout(int timeout);
+    virtual void setGuard(int guard);
+
+private:
+    uint32_t _buf_size;
+    std::map<std::string, std::string> _responses;
+    std::string _default;
+    std::string _tx;
+    std::string _pending;
+    bool _has_pending;
+    std::string _rx;
+    size_t _rx_pos;
+
+    void command(const std::string &frame);
+};
+#endif
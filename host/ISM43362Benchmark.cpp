@@ -0,0 +1,285 @@
+/* ISM43362 throughput and latency benchmark
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "ISM43362Benchmark.h"
+
+// Max time waiting for data from the peer
+#define ISM43362_BENCH_RECV_TIMEOUT 5000 /* milliseconds */
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+static int compare_samples(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+ISM43362Benchmark::ISM43362Benchmark(NetworkInterface *net, Callback<void(const char *)> output)
+    : _net(net), _output(output)
+{
+    for (unsigned i = 0; i < sizeof(_buffer); i++) {
+        _buffer[i] = 'a' + (i % 26);
+    }
+}
+
+int ISM43362Benchmark::tcp_upload(const SocketAddress &sink, uint32_t size, ism43362_bench_result_t *out)
+{
+    ism43362_bench_result_t res;
+    TCPSocket sock;
+    Timer timer;
+
+    start(&res, "tcp_upload");
+    res.error = sock.open(_net);
+    if (res.error == 0) {
+        res.error = sock.connect(sink);
+    }
+
+    if (res.error == 0) {
+        timer.start();
+        while (res.bytes < size) {
+            int n = sock.send(_buffer, MIN(sizeof(_buffer), size - res.bytes));
+            if (n < 0) {
+                res.error = n;
+                break;
+            }
+            res.bytes += n;
+            res.count++;
+        }
+        res.duration_us = timer.read_us();
+    }
+
+    sock.close();
+    return finish(&res, out);
+}
+
+int ISM43362Benchmark::tcp_download(const SocketAddress &source, uint32_t size, ism43362_bench_result_t *out)
+{
+    ism43362_bench_result_t res;
+    TCPSocket sock;
+    Timer timer;
+
+    start(&res, "tcp_download");
+    res.error = sock.open(_net);
+    if (res.error == 0) {
+        sock.set_timeout(ISM43362_BENCH_RECV_TIMEOUT);
+        res.error = sock.connect(source);
+    }
+
+    if (res.error == 0) {
+        timer.start();
+        while (res.bytes < size) {
+            int n = sock.recv(_buffer, MIN(sizeof(_buffer), size - res.bytes));
+            if (n <= 0) {
+                res.error = (n < 0) ? n : NSAPI_ERROR_CONNECTION_LOST;
+                break;
+            }
+            res.bytes += n;
+            res.count++;
+        }
+        res.duration_us = timer.read_us();
+    }
+
+    sock.close();
+    return finish(&res, out);
+}
+
+int ISM43362Benchmark::udp_send(const SocketAddress &sink, uint32_t count, uint32_t size, ism43362_bench_result_t *out)
+{
+    ism43362_bench_result_t res;
+    UDPSocket sock;
+    Timer timer;
+
+    start(&res, "udp_send");
+    size = MIN(size, sizeof(_buffer));
+    res.error = sock.open(_net);
+
+    if (res.error == 0) {
+        timer.start();
+        while (res.count < count) {
+            int n = sock.sendto(sink, _buffer, size);
+            if (n < 0) {
+                res.error = n;
+                break;
+            }
+            res.bytes += n;
+            res.count++;
+        }
+        res.duration_us = timer.read_us();
+    }
+
+    sock.close();
+    return finish(&res, out);
+}
+
+int ISM43362Benchmark::tcp_round_trip(const SocketAddress &echo, uint32_t count, uint32_t size, ism43362_bench_result_t *out)
+{
+    ism43362_bench_result_t res;
+    TCPSocket sock;
+    Timer timer;
+    uint32_t *samples = new uint32_t[count];
+
+    start(&res, "tcp_round_trip");
+    size = MIN(size, sizeof(_buffer));
+    res.error = sock.open(_net);
+    if (res.error == 0) {
+        sock.set_timeout(ISM43362_BENCH_RECV_TIMEOUT);
+        res.error = sock.connect(echo);
+    }
+
+    if (res.error == 0) {
+        timer.start();
+        while ((res.count < count) && (res.error == 0)) {
+            uint32_t t0 = timer.read_us();
+            /* the message may be sent in several parts */
+            uint32_t sent = 0;
+            while (sent < size) {
+                int n = sock.send(_buffer + sent, size - sent);
+                if (n < 0) {
+                    res.error = n;
+                    break;
+                }
+                sent += n;
+            }
+            if (res.error != 0) {
+                break;
+            }
+            /* the echo may come back in several parts */
+            uint32_t received = 0;
+            while (received < size) {
+                int n = sock.recv(_buffer + received, size - received);
+                if (n <= 0) {
+                    res.error = (n < 0) ? n : NSAPI_ERROR_CONNECTION_LOST;
+                    break;
+                }
+                received += n;
+            }
+            if (res.error == 0) {
+                samples[res.count++] = timer.read_us() - t0;
+                res.bytes += size;
+            }
+        }
+        res.duration_us = timer.read_us();
+    }
+
+    sock.close();
+    latency(&res, samples, res.count);
+    delete[] samples;
+    return finish(&res, out);
+}
+
+int ISM43362Benchmark::connect_time(const SocketAddress &server, uint32_t count, ism43362_bench_result_t *out)
+{
+    ism43362_bench_result_t res;
+    Timer timer;
+    uint32_t *samples = new uint32_t[count];
+
+    start(&res, "connect_time");
+    timer.start();
+    while ((res.count < count) && (res.error == 0)) {
+        TCPSocket sock;
+        res.error = sock.open(_net);
+        if (res.error == 0) {
+            uint32_t t0 = timer.read_us();
+            res.error = sock.connect(server);
+            if (res.error == 0) {
+                samples[res.count++] = timer.read_us() - t0;
+            }
+        }
+        sock.close();
+    }
+    res.duration_us = timer.read_us();
+
+    latency(&res, samples, res.count);
+    delete[] samples;
+    return finish(&res, out);
+}
+
+int ISM43362Benchmark::dns_time(const char *host, uint32_t count, ism43362_bench_result_t *out)
+{
+    ism43362_bench_result_t res;
+    Timer timer;
+    uint32_t *samples = new uint32_t[count];
+
+    start(&res, "dns_time");
+    timer.start();
+    while ((res.count < count) && (res.error == 0)) {
+        SocketAddress address;
+        uint32_t t0 = timer.read_us();
+        res.error = _net->gethostbyname(host, &address);
+        if (res.error == 0) {
+            samples[res.count++] = timer.read_us() - t0;
+        }
+    }
+    res.duration_us = timer.read_us();
+
+    latency(&res, samples, res.count);
+    delete[] samples;
+    return finish(&res, out);
+}
+
+void ISM43362Benchmark::start(ism43362_bench_result_t *res, const char *name)
+{
+    memset(res, 0, sizeof(*res));
+    res->name = name;
+}
+
+void ISM43362Benchmark::latency(ism43362_bench_result_t *res, uint32_t *samples, uint32_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    qsort(samples, count, sizeof(uint32_t), compare_samples);
+    res->min_us = samples[0];
+    res->p50_us = samples[((count - 1) * 50) / 100];
+    res->p99_us = samples[((count - 1) * 99) / 100];
+    res->max_us = samples[count - 1];
+}
+
+int ISM43362Benchmark::finish(ism43362_bench_result_t *res, ism43362_bench_result_t *out)
+{
+    char line[256];
+    uint32_t kbps = 0;
+    uint32_t ops = 0;
+
+    if (res->duration_us != 0) {
+        kbps = (uint32_t)(((uint64_t)res->bytes * 8000) / res->duration_us);
+        ops = (uint32_t)(((uint64_t)res->count * 1000000) / res->duration_us);
+    }
+
+    snprintf(line, sizeof(line),
+             "{\"name\":\"%s\",\"error\":%d,\"count\":%lu,\"bytes\":%lu,\"duration_us\":%lu,"
+             "\"kbps\":%lu,\"ops_per_s\":%lu,\"min_us\":%lu,\"p50_us\":%lu,\"p99_us\":%lu,\"max_us\":%lu}",
+             res->name, res->error, (unsigned long)res->count, (unsigned long)res->bytes,
+             (unsigned long)res->duration_us, (unsigned long)kbps, (unsigned long)ops,
+             (unsigned long)res->min_us, (unsigned long)res->p50_us, (unsigned long)res->p99_us,
+             (unsigned long)res->max_us);
+
+    if (_output) {
+        _output(line);
+    } else {
+        printf("%s\r\n", line);
+    }
+
+    if (out) {
+        *out = *res;
+    }
+
+    return res->error;
+}
@@ -0,0 +1,117 @@
+/* ISM43362 throughput and latency benchmark
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ISM43362_BENCHMARK_H
+#define ISM43362_BENCHMARK_H
+
+#include "mbed.h"
+
+/** Result of a benchmark run
+ */
+typedef struct {
+    const char *name;       /**< Name of the benchmark */
+    int error;              /**< 0 on success, negative error code of the first failure otherwise */
+    uint32_t count;         /**< Number of successful operations (packets, round trips, connections, lookups) */
+    uint32_t bytes;         /**< Number of payload bytes transferred */
+    uint32_t duration_us;   /**< Duration of the whole run */
+    uint32_t min_us;        /**< Lowest operation latency, 0 when not applicable */
+    uint32_t p50_us;        /**< Median operation latency */
+    uint32_t p99_us;        /**< 99th percentile operation latency */
+    uint32_t max_us;        /**< Highest operation latency */
+} ism43362_bench_result_t;
+
+/** ISM43362Benchmark class
+ *  Throughput and latency measurements through the public network API
+ *
+ *  The peer is a sink, source or echo server (e.g. a TCP discard, chargen or
+ *  echo service). Each run reports its result as one JSON line.
+ *
+ *  @code
+ *  ISM43362Benchmark bench(&wifi);
+ *  bench.tcp_upload(SocketAddress("192.168.1.2", 9), 100000);
+ *  bench.tcp_round_trip(SocketAddress("192.168.1.2", 7), 100, 32);
+ *  @endcode
+ */
+class ISM43362Benchmark
+{
+public:
+    /** ISM43362Benchmark lifetime
+     * @param net       Network interface to benchmark
+     * @param output    Function called with each JSON result line, results are printed on stdout if none
+     */
+    ISM43362Benchmark(NetworkInterface *net, Callback<void(const char *)> output = NULL);
+
+    /** Measure TCP upload throughput
+     * @param sink      Address of a server discarding received data
+     * @param size      Number of bytes to send
+     * @param res       Destination for the result, or NULL
+     * @return          0 on success, negative error code on failure
+     */
+    int tcp_upload(const SocketAddress &sink, uint32_t size, ism43362_bench_result_t *res = NULL);
+
+    /** Measure TCP download throughput
+     * @param source    Address of a server sending data once connected
+     * @param size      Number of bytes to receive
+     * @param res       Destination for the result, or NULL
+     * @return          0 on success, negative error code on failure
+     */
+    int tcp_download(const SocketAddress &source, uint32_t size, ism43362_bench_result_t *res = NULL);
+
+    /** Measure UDP packets per second
+     * @param sink      Address of a server receiving the packets
+     * @param count     Number of packets to send
+     * @param size      Size of each packet
+     * @param res       Destination for the result, or NULL
+     * @return          0 on success, negative error code on failure
+     */
+    int udp_send(const SocketAddress &sink, uint32_t count, uint32_t size, ism43362_bench_result_t *res = NULL);
+
+    /** Measure small message round trip latency distribution
+     * @param echo      Address of a TCP echo server
+     * @param count     Number of round trips
+     * @param size      Size of each message, up to 1024 bytes
+     * @param res       Destination for the result, or NULL
+     * @return          0 on success, negative error code on failure
+     */
+    int tcp_round_trip(const SocketAddress &echo, uint32_t count, uint32_t size, ism43362_bench_result_t *res = NULL);
+
+    /** Measure TCP connection time distribution
+     * @param server    Address of a TCP server
+     * @param count     Number of connections
+     * @param res       Destination for the result, or NULL
+     * @return          0 on success, negative error code on failure
+     */
+    int connect_time(const SocketAddress &server, uint32_t count, ism43362_bench_result_t *res = NULL);
+
+    /** Measure DNS resolution time distribution
+     * @param host      Hostname to resolve
+     * @param count     Number of lookups
+     * @param res       Destination for the result, or NULL
+     * @return          0 on success, negative error code on failure
+     */
+    int dns_time(const char *host, uint32_t count, ism43362_bench_result_t *res = NULL);
+
+private:
+    NetworkInterface *_net;
+    Callback<void(const char *)> _output;
+    uint8_t _buffer[1024];
+
+    void start(ism43362_bench_result_t *res, const char *name);
+    void latency(ism43362_bench_result_t *res, uint32_t *samples, uint32_t count);
+    int finish(ism43362_bench_result_t *res, ism43362_bench_result_t *out);
+};
+
+#endif
@@ -0,0 +1,671 @@
+/**
+ * @file    ISM43362Emulator.cpp
+ * @brief   Emulation of the ISM43362 SPI AT firmware on Linux
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "ISM43362Emulator.h"
+#include "mbed_debug.h"
+
+// change to true to print the emulated commands
+#define local_debug false
+
+// Largest packet of R1 and S3, like ES_WIFI_MAX_RX_PACKET_SIZE
+#define EMULATOR_MAX_PACKET 1200
+
+// Time allowed to the TCP handshake of P6=1
+#define EMULATOR_CONNECT_TIMEOUT 5000 /* milliseconds */
+
+// Firmware version reported by I?
+#define EMULATOR_FIRMWARE "ISM43362-M3G-L44-SPI,C3.5.2.5.STM,v3.5.2,v1.4.0.rc1,v8.2.1,120000000,Inventek eS-WiFi"
+
+// MAC address reported by Z5, locally administered
+#define EMULATOR_MAC "02:00:00:43:62:00"
+
+ISM43362Emulator::ISM43362Emulator(PinName resetpin)
+    : BufferedSpi(NC, NC, NC, NC, NC), _resetpin(resetpin), _selected(false), _resp_pos(0),
+      _words(0), _latency_us(0), _spi_hz(0), _commands(0), _uart_fd(-1), _uart_stop(false),
+      _ap(0)
+{
+    _ap_rssi[0] = -40;
+    for (int i = 1; i < ISM43362_EMULATOR_APS; i++) {
+        _ap_rssi[i] = 0;
+    }
+    for (int i = 0; i < ISM43362_EMULATOR_SOCKETS; i++) {
+        _sockets[i].listen_fd = -1;
+        _sockets[i].fd = -1;
+    }
+    host_gpio_attach(_resetpin, callback(this, &ISM43362Emulator::reset_pin));
+
+    /* The module sends its prompt once powered */
+    boot();
+}
+
+ISM43362Emulator::~ISM43362Emulator(void)
+{
+    if (_uart_thread.joinable()) {
+        _uart_stop = true;
+        _uart_thread.join();
+    }
+    host_gpio_attach(_resetpin, NULL);
+    for (int i = 0; i < ISM43362_EMULATOR_SOCKETS; i++) {
+        socket_close(&_sockets[i]);
+    }
+}
+
+void ISM43362Emulator::set_timing(uint32_t latency_us, uint32_t spi_hz)
+{
+    _latency_us = latency_us;
+    _spi_hz = spi_hz;
+}
+
+void ISM43362Emulator::set_rssi(int rssi, int ap)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    if ((ap >= 0) && (ap < ISM43362_EMULATOR_APS)) {
+        _ap_rssi[ap] = rssi;
+    }
+}
+
+void ISM43362Emulator::reset_pin(int value)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    if (value == 1) {
+        boot();
+    }
+}
+
+void ISM43362Emulator::serve_uart(int fd)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    /* The boot prompt is sent by the reset done by the driver */
+    _resp.clear();
+    _resp_pos = 0;
+    _uart_fd = fd;
+    _uart_thread = std::thread(&ISM43362Emulator::uart_loop, this);
+}
+
+/* UART side */
+
+void ISM43362Emulator::uart_loop(void)
+{
+    std::string line;
+    char buf[256];
+
+    while (!_uart_stop) {
+        struct pollfd pfd = { _uart_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 10) <= 0) {
+            continue;
+        }
+        ssize_t n = ::read(_uart_fd, buf, sizeof(buf));
+        if (n <= 0) {
+            poll(NULL, 0, 1);
+            continue;
+        }
+        line.append(buf, n);
+
+        while (true) {
+            /* The "\n" of the "\r\n" delimiter ends the previous command */
+            size_t start = line.find_first_not_of('\n');
+            line.erase(0, (start == std::string::npos) ? line.size() : start);
+            size_t end = line.find('\r');
+            if (end == std::string::npos) {
+                break;
+            }
+            /* S3 and PG are followed by their data, which length is their last argument */
+            size_t len = end + 1;
+            std::string command = line.substr(0, 2);
+            if ((command == "S3") || (command == "PG")) {
+                size_t comma = line.rfind(',', end);
+                size_t arg = (command == "PG" && comma != std::string::npos) ? comma + 1 : 3;
+                len += atoi(line.substr(arg, end - arg).c_str());
+            }
+            if (line.size() < len) {
+                break;
+            }
+
+            std::string frame = line.substr(0, len);
+            line.erase(0, len);
+            std::lock_guard<std::recursive_mutex> lock(_mutex);
+            _commands++;
+            if (_latency_us != 0) {
+                wait_us(_latency_us);
+            }
+            execute(frame);
+        }
+    }
+}
+
+void ISM43362Emulator::boot(void)
+{
+    for (int i = 0; i < ISM43362_EMULATOR_SOCKETS; i++) {
+        socket_close(&_sockets[i]);
+        socket_reset(&_sockets[i]);
+    }
+    _ssid.clear();
+    _pass.clear();
+    _security = 0;
+    _dhcp = 1;
+    _joined = false;
+    _id = 0;
+    _cmd.clear();
+    _messages.clear();
+
+    respond("\r\n> ");
+}
+
+/* SPI side */
+
+int ISM43362Emulator::spi_transfer(int value)
+{
+    _words++;
+
+    /* While a response is pending, the host clocks it out */
+    if (_resp_pos < _resp.size()) {
+        int word = (uint8_t)_resp[_resp_pos] | ((uint8_t)_resp[_resp_pos + 1] << 8);
+        _resp_pos += 2;
+        return word;
+    }
+
+    _cmd += (char)(value & 0xFF);
+    _cmd += (char)((value >> 8) & 0xFF);
+    return 0x1515;
+}
+
+int ISM43362Emulator::dataready_read(void)
+{
+    if (_resp_pos < _resp.size()) {
+        return 1;
+    }
+
+    /* Low after the last word of a response, high again once deselected */
+    return _selected ? 0 : 1;
+}
+
+void ISM43362Emulator::enable_nss(void)
+{
+    _selected = true;
+    _words = 0;
+    if (_resp_pos >= _resp.size()) {
+        _resp.clear();
+        _resp_pos = 0;
+    }
+}
+
+void ISM43362Emulator::disable_nss(void)
+{
+    if (!_selected) {
+        return;
+    }
+    _selected = false;
+
+    if (_spi_hz != 0) {
+        wait_us((uint32_t)(((uint64_t)_words * 16 * 1000000) / _spi_hz));
+    }
+
+    if (_cmd.empty()) {
+        return;
+    }
+
+    std::string frame;
+    frame.swap(_cmd);
+    _commands++;
+    if (_latency_us != 0) {
+        wait_us(_latency_us);
+    }
+    execute(frame);
+}
+
+void ISM43362Emulator::respond(const std::string &frame)
+{
+    if (_uart_fd >= 0) {
+        for (size_t done = 0; done < frame.size();) {
+            ssize_t n = ::write(_uart_fd, frame.data() + done, frame.size() - done);
+            if (n <= 0) {
+                return;
+            }
+            done += n;
+        }
+        return;
+    }
+
+    _resp = frame;
+    /* The module stuffs its responses to a whole number of words */
+    if (_resp.size() & 1) {
+        _resp += (char)0x15;
+    }
+    _resp_pos = 0;
+    /* Data ready rises once the response is ready */
+    DatareadyRising();
+}
+
+void ISM43362Emulator::ok(const std::string &data)
+{
+    if (data.empty()) {
+        respond("\r\nOK\r\n> ");
+    } else {
+        respond("\r\n" + data + "\r\nOK\r\n> ");
+    }
+}
+
+void ISM43362Emulator::fail(void)
+{
+    respond("\r\nERROR\r\n> ");
+}
+
+/* Command decoding */
+
+std::string ISM43362Emulator::access_point_bssid(int ap)
+{
+    char bssid[18];
+
+    snprintf(bssid, sizeof(bssid), "02:00:00:43:62:%02x", ap + 1);
+    return bssid;
+}
+
+void ISM43362Emulator::execute(const std::string &frame)
+{
+    /* <command>[=<arguments>]\r followed by the delimiter or, for S3 and PG,
+     * by the data, then by the padding of odd frames */
+    size_t end = frame.find('\r');
+    std::string line = frame.substr(0, end);
+    std::string data = (end == std::string::npos) ? "" : frame.substr(end + 1);
+    std::string command = line.substr(0, 2);
+    std::string arg = (line.size() > 3 && line[2] == '=') ? line.substr(3) : "";
+    int value = atoi(arg.c_str());
+    socket *s = &_sockets[_id];
+    char tmp[256];
+
+    debug_if(local_debug, "EMU> %s\r\n", line.c_str());
+
+    /* The servers accept their clients in the background */
+    for (int i = 0; i < ISM43362_EMULATOR_SOCKETS; i++) {
+        socket_accept(&_sockets[i]);
+    }
+
+    if (command == "I?") {
+        ok(EMULATOR_FIRMWARE);
+    } else if (command == "Z5") {
+        ok(EMULATOR_MAC);
+    } else if (command == "C1") {
+        _ssid = arg;
+        ok();
+    } else if (command == "C2") {
+        _pass = arg;
+        ok();
+    } else if (command == "C3") {
+        _security = value;
+        ok();
+    } else if (command == "C4") {
+        _dhcp = value;
+        ok();
+    } else if (command == "C0") {
+        int ap = -1;
+        for (int i = 0; i < ISM43362_EMULATOR_APS; i++) {
+            if ((_ap_rssi[i] != 0) && ((ap < 0) || (_ap_rssi[i] > _ap_rssi[ap]))) {
+                ap = i;
+            }
+        }
+        if (_ssid.empty() || (ap < 0)) {
+            fail();
+            return;
+        }
+        _ap = ap;
+        _joined = true;
+        ok("[JOIN   ] " + _ssid + ",127.0.0.1,0,0");
+    } else if (command == "CD") {
+        for (int i = 0; i < ISM43362_EMULATOR_SOCKETS; i++) {
+            socket_close(&_sockets[i]);
+        }
+        _joined = false;
+        ok();
+    } else if (command == "C?") {
+        const char *ip = _joined ? "127.0.0.1" : "0.0.0.0";
+        snprintf(tmp, sizeof(tmp), "%s,%s,%d,%d,0,%s,255.0.0.0,%s,127.0.0.1,0.0.0.0,5,0,0,US,%d,%s",
+                 _ssid.c_str(), _pass.c_str(), _security, _dhcp, ip, ip, _joined ? 1 : 0,
+                 _joined ? access_point_bssid(_ap).c_str() : "00:00:00:00:00:00");
+        ok(tmp);
+    } else if (command == "CR") {
+        snprintf(tmp, sizeof(tmp), "%d", _joined ? _ap_rssi[_ap] : 0);
+        ok(tmp);
+    } else if (command == "F0") {
+        std::string list;
+        for (int i = 0; i < ISM43362_EMULATOR_APS; i++) {
+            if (_ap_rssi[i] == 0) {
+                continue;
+            }
+            snprintf(tmp, sizeof(tmp), "#%03d,\"%s\",%s,%d,72.20,Infrastructure,Open,2.4GHz,6\r\n", i + 1,
+                     _ssid.empty() ? "ism43362-emulator" : _ssid.c_str(), access_point_bssid(i).c_str(), _ap_rssi[i]);
+            list += tmp;
+        }
+        /* the last line ends with the response */
+        ok(list.substr(0, list.empty() ? 0 : list.size() - 2));
+    } else if (command == "D0") {
+        struct addrinfo hints, *res;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        if (!_joined || getaddrinfo(arg.c_str(), NULL, &hints, &res) != 0) {
+            fail();
+            return;
+        }
+        inet_ntop(AF_INET, &((struct sockaddr_in *)res->ai_addr)->sin_addr, tmp, sizeof(tmp));
+        freeaddrinfo(res);
+        ok(tmp);
+    } else if (command == "P0") {
+        if (value < 0 || value >= ISM43362_EMULATOR_SOCKETS || arg.empty()) {
+            fail();
+            return;
+        }
+        _id = value;
+        ok();
+    } else if (command == "P1") {
+        /* 0 TCP, 1 UDP, 3 TLS which is emulated as TCP */
+        s->protocol = value;
+        ok();
+    } else if (command == "P2") {
+        s->local_port = value;
+        ok();
+    } else if (command == "P3") {
+        s->remote_ip = arg;
+        ok();
+    } else if (command == "P4") {
+        s->remote_port = value;
+        ok();
+    } else if (command == "P5") {
+        if (value == 0) {
+            /* The client of the server is closed with it */
+            socket_close(s);
+            ok();
+        } else if (_joined && socket_start_server(s)) {
+            ok();
+        } else {
+            fail();
+        }
+    } else if (command == "P6") {
+        if (value == 0) {
+            if (s->fd >= 0) {
+                ::close(s->fd);
+                s->fd = -1;
+            }
+            ok();
+        } else if (_joined && socket_start_client(s)) {
+            ok();
+        } else {
+            fail();
+        }
+    } else if (command == "P?") {
+        /* A server reports the address of its client */
+        bool peer = (s->listen_fd >= 0) && (s->fd >= 0);
+        std::string remote_ip = peer ? s->peer_ip : s->remote_ip;
+        snprintf(tmp, sizeof(tmp), "%d,127.0.0.1,%d,%s,%d,0,1,%d,%d,0,0",
+                 s->protocol, s->local_port, remote_ip.empty() ? "0.0.0.0" : remote_ip.c_str(),
+                 peer ? s->peer_port : s->remote_port, s->listen_fd >= 0 ? 1 : 0,
+                 (s->fd >= 0 && !s->peer_closed) ? 1 : 0);
+        ok(tmp);
+    } else if (command == "PK") {
+        if (s->fd >= 0) {
+            int on = (value != 0);
+            setsockopt(s->fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+            s->keepalive = on;
+        }
+        ok();
+    } else if (command == "PG") {
+        /* Certificates are accepted but not used, there is no TLS */
+        ok();
+    } else if (command == "MR") {
+        ok(_messages.empty() ? "[SOMA][EOMA]" : _messages);
+        _messages.clear();
+    } else if (command == "R0") {
+        socket_read(s);
+    } else if (command == "R1") {
+        if (value <= 0 || value > EMULATOR_MAX_PACKET) {
+            fail();
+            return;
+        }
+        s->rx_packet = value;
+        ok();
+    } else if (command == "R2") {
+        s->rx_timeout = value;
+        ok();
+    } else if (command == "S2") {
+        s->tx_timeout = value;
+        ok();
+    } else if (command == "S3") {
+        if (value < 0 || value > EMULATOR_MAX_PACKET || (size_t)value > data.size()) {
+            fail();
+            return;
+        }
+        socket_write(s, data.substr(0, value));
+    } else {
+        fail();
+    }
+}
+
+/* Sockets, on the Linux loopback */
+
+void ISM43362Emulator::socket_reset(socket *s)
+{
+    s->protocol = 0;
+    s->local_port = 0;
+    s->remote_ip.clear();
+    s->remote_port = 0;
+    s->peer_closed = false;
+    s->peer_ip.clear();
+    s->peer_port = 0;
+    s->rx_packet = EMULATOR_MAX_PACKET;
+    s->rx_timeout = 0;
+    s->tx_timeout = 0;
+    s->keepalive = false;
+}
+
+void ISM43362Emulator::socket_close(socket *s)
+{
+    if (s->listen_fd >= 0) {
+        ::close(s->listen_fd);
+        s->listen_fd = -1;
+    }
+    if (s->fd >= 0) {
+        ::close(s->fd);
+        s->fd = -1;
+    }
+}
+
+bool ISM43362Emulator::socket_start_client(socket *s)
+{
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(s->remote_port);
+    if (inet_pton(AF_INET, s->remote_ip.c_str(), &addr.sin_addr) != 1) {
+        return false;
+    }
+
+    if (s->fd >= 0) {
+        ::close(s->fd);
+    }
+    s->keepalive = false;
+    s->fd = ::socket(AF_INET, (s->protocol == 1) ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (s->fd < 0) {
+        return false;
+    }
+    s->peer_closed = false;
+
+    /* Bounded connect, the module gives up on unreachable peers */
+    fcntl(s->fd, F_SETFL, O_NONBLOCK);
+    if (::connect(s->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        struct pollfd pfd = { s->fd, POLLOUT, 0 };
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if ((errno != EINPROGRESS) || (poll(&pfd, 1, EMULATOR_CONNECT_TIMEOUT) != 1)
+                || (getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) || (err != 0)) {
+            ::close(s->fd);
+            s->fd = -1;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ISM43362Emulator::socket_start_server(socket *s)
+{
+    struct sockaddr_in addr;
+    int on = 1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(s->local_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (s->listen_fd >= 0) {
+        ::close(s->listen_fd);
+    }
+    s->listen_fd = ::socket(AF_INET, (s->protocol == 1) ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (s->listen_fd < 0) {
+        return false;
+    }
+    setsockopt(s->listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if ((::bind(s->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+            || ((s->protocol != 1) && (::listen(s->listen_fd, 1) < 0))) {
+        ::close(s->listen_fd);
+        s->listen_fd = -1;
+        return false;
+    }
+    fcntl(s->listen_fd, F_SETFL, O_NONBLOCK);
+
+    return true;
+}
+
+void ISM43362Emulator::socket_accept(socket *s)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    char tmp[64];
+
+    /* The backlog of the module is one connection, served on the same id
+     * until the host closes it */
+    if ((s->listen_fd < 0) || (s->protocol == 1) || (s->fd >= 0)) {
+        return;
+    }
+
+    int fd = ::accept(s->listen_fd, (struct sockaddr *)&addr, &len);
+    if (fd < 0) {
+        return;
+    }
+    s->fd = fd;
+    s->peer_closed = false;
+    s->peer_ip = inet_ntoa(addr.sin_addr);
+    s->peer_port = ntohs(addr.sin_port);
+
+    /* The connection message is queued for MR, shared by all the sockets */
+    snprintf(tmp, sizeof(tmp), "[SOMA]Accepted %s:%d[EOMA]", s->peer_ip.c_str(), s->peer_port);
+    _messages += tmp;
+}
+
+void ISM43362Emulator::socket_read(socket *s)
+{
+    char data[EMULATOR_MAX_PACKET];
+    int fd = s->fd;
+    bool datagram_server = false;
+
+    /* UDP servers read their datagrams on the bound socket */
+    if ((fd < 0) && (s->protocol == 1) && (s->listen_fd >= 0)) {
+        fd = s->listen_fd;
+        datagram_server = true;
+    }
+    if (fd < 0) {
+        fail();
+        return;
+    }
+    if (s->peer_closed) {
+        ok();
+        return;
+    }
+
+    /* Wait up to the read timeout for the first byte */
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    if (poll(&pfd, 1, s->rx_timeout) <= 0) {
+        ok();
+        return;
+    }
+
+    ssize_t n;
+    if (datagram_server) {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        n = recvfrom(fd, data, s->rx_packet, MSG_DONTWAIT, (struct sockaddr *)&addr, &len);
+        if (n >= 0) {
+            s->peer_ip = inet_ntoa(addr.sin_addr);
+            s->peer_port = ntohs(addr.sin_port);
+        }
+    } else {
+        n = recv(fd, data, s->rx_packet, MSG_DONTWAIT);
+    }
+
+    if (n == 0 && s->protocol != 1) {
+        s->peer_closed = true;
+        ok();
+    } else if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            ok();
+        } else {
+            fail();
+        }
+    } else {
+        ok(std::string(data, n));
+    }
+}
+
+void ISM43362Emulator::socket_write(socket *s, const std::string &data)
+{
+    ssize_t n;
+
+    if ((s->fd < 0) && (s->protocol == 1) && (s->listen_fd >= 0) && !s->peer_ip.empty()) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(s->peer_port);
+        inet_pton(AF_INET, s->peer_ip.c_str(), &addr.sin_addr);
+        n = sendto(s->listen_fd, data.data(), data.size(), 0, (struct sockaddr *)&addr, sizeof(addr));
+    } else if ((s->fd >= 0) && !s->peer_closed) {
+        /* The write timeout bounds the wait for room in the socket */
+        struct pollfd pfd = { s->fd, POLLOUT, 0 };
+        if (poll(&pfd, 1, s->tx_timeout) <= 0) {
+            fail();
+            return;
+        }
+        n = ::send(s->fd, data.data(), data.size(), MSG_NOSIGNAL);
+    } else {
+        fail();
+        return;
+    }
+
+    if (n < 0) {
+        fail();
+        return;
+    }
+    ok();
+}
@@ -0,0 +1,197 @@
+/**
+ * @file    ISM43362Emulator.h
+ * @brief   Emulation of the ISM43362 SPI AT firmware on Linux
+ * @version 1.0
+ * @see
+ *
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ISM43362EMULATOR_H
+#define ISM43362EMULATOR_H
+
+#include <string>
+#include <thread>
+#include "mbed.h"
+#include "BufferedSpi.h"
+
+/** Number of sockets of the module */
+#define ISM43362_EMULATOR_SOCKETS 4
+
+/** Number of access points sharing the SSID */
+#define ISM43362_EMULATOR_APS 2
+
+/**
+ *  @class ISM43362Emulator
+ *  @brief BufferedSpi link to an emulated module instead of the real one
+ *
+ *  The emulator implements the module side of the SPI protocol through the
+ *  BufferedSpi hardware hooks: command frames are decoded when NSS goes
+ *  high, then the response is framed like the firmware does ("\r\n" header,
+ *  OK or ERROR, "> " prompt, 0x15 stuffing to a whole number of words) and
+ *  announced with a rising edge of data ready. Data ready stays high while
+ *  the response is clocked out and drops after its last word.
+ *
+ *  Supported commands:
+ *  - C0 to C4, C?, CR, CD: the join succeeds once a SSID is set and an access
+ *    point is in range, the module gets 127.0.0.1. C? ends with the BSSID
+ *  - F0: the open access points in range
+ *  - D0: resolved with getaddrinfo
+ *  - P0 to P6, P?, PK, PG, MR: sockets are Linux sockets on the loopback,
+ *    TLS sockets are plain TCP and certificates are ignored. Servers accept
+ *    their client before each command and queue its message for MR
+ *  - R0 to R2, S2, S3: data is read and written on the Linux sockets
+ *  - I?, Z5
+ *
+ *  A rising edge on the reset pin restarts the emulated firmware: sockets
+ *  are closed, the network is left and the boot prompt is sent again.
+ *
+ *  With serve_uart(), the module is the one of the UART variants instead:
+ *  commands are read from a serial line and the responses are written to it
+ *  without stuffing.
+ *
+ *  Example:
+ *  @code
+ *  ISM43362 wifi(new ISM43362Emulator(RESET_PIN), RESET_PIN, NC);
+ *  @endcode
+ */
+class ISM43362Emulator : public BufferedSpi
+{
+public:
+    /** Create an emulated module
+     *  @param resetpin pin restarting the module on a rising edge, NC for none
+     */
+    ISM43362Emulator(PinName resetpin = NC);
+
+    virtual ~ISM43362Emulator(void);
+
+    /** Set the timing of the emulated module
+     *
+     *  Without timing, responses are ready as soon as a command is written
+     *  and words are transferred as fast as the host allows.
+     *
+     *  @param latency_us time between the end of a command and its response
+     *  @param spi_hz SPI clock, each word taking 16 clock periods, 0 for none
+     */
+    void set_timing(uint32_t latency_us, uint32_t spi_hz);
+
+    /** Set the RSSI of an access point, reported by F0, and by CR once joined
+     *
+     *  The access points share the SSID of C1 and have the BSSIDs
+     *  02:00:00:43:62:01 and up. C0 joins the strongest one in range.
+     *
+     *  @param rssi signal strength in dBm, 0 for out of range, the default
+     *              of all the access points but the first
+     *  @param ap index of the access point, below ISM43362_EMULATOR_APS
+     */
+    void set_rssi(int rssi, int ap = 0);
+
+    /** Serve the module on a serial line instead of SPI
+     *
+     *  A thread reads the commands until the emulator is destroyed.
+     *
+     *  @param fd file descriptor of the module side of the line, e.g. a pty
+     */
+    void serve_uart(int fd);
+
+    /** Number of commands decoded since the creation of the emulator
+     */
+    uint32_t commands(void) const
+    {
+        return _commands;
+    }
+
+    /** Check if PK enabled the keep alive of the connection of a socket
+     *  @param id socket id, below ISM43362_EMULATOR_SOCKETS
+     */
+    bool keepalive(int id) const
+    {
+        return _sockets[id].keepalive;
+    }
+
+    /** Read timeout set by R2 for a socket, in milliseconds
+     *  @param id socket id, below ISM43362_EMULATOR_SOCKETS
+     */
+    int read_timeout(int id) const
+    {
+        return _sockets[id].rx_timeout;
+    }
+
+    virtual void enable_nss(void);
+    virtual void disable_nss(void);
+
+protected:
+    virtual int spi_transfer(int value);
+    virtual int dataready_read(void);
+
+private:
+    struct socket {
+        int protocol;
+        int local_port;
+        std::string remote_ip;
+        int remote_port;
+        int listen_fd;
+        int fd;
+        bool peer_closed;
+        std::string peer_ip;
+        int peer_port;
+        int rx_packet;
+        int rx_timeout;
+        int tx_timeout;
+        bool keepalive;
+    };
+
+    PinName _resetpin;
+    bool _selected;
+    std::string _cmd;
+    std::string _resp;
+    size_t _resp_pos;
+    uint32_t _words;
+    uint32_t _latency_us;
+    uint32_t _spi_hz;
+    uint32_t _commands;
+    std::recursive_mutex _mutex;
+    int _uart_fd;
+    volatile bool _uart_stop;
+    std::thread _uart_thread;
+
+    std::string _ssid;
+    std::string _pass;
+    int _security;
+    int _dhcp;
+    bool _joined;
+    int _ap_rssi[ISM43362_EMULATOR_APS];
+    int _ap;
+    int _id;
+    socket _sockets[ISM43362_EMULATOR_SOCKETS];
+    std::string _messages;
+
+    void reset_pin(int value);
+    void uart_loop(void);
+    void boot(void);
+    void respond(const std::string &frame);
+    void ok(const std::string &data = "");
+    void fail(void);
+    void execute(const std::string &frame);
+    static std::string access_point_bssid(int ap);
+    void socket_reset(socket *s);
+    void socket_close(socket *s);
+    bool socket_start_client(socket *s);
+    bool socket_start_server(socket *s);
+    void socket_accept(socket *s);
+    void socket_read(socket *s);
+    void socket_write(socket *s, const std::string &data);
+};
+#endif
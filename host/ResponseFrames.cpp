@@ -0,0 +1,100 @@
+/* Module response frames for the parser benchmark and fuzz harness
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include "ResponseFrames.h"
+#include "SpiRecorder.h"
+
+// Trailer of the responses, after the data
+#define FRAME_OK "\r\nOK\r\n> "
+
+static const char *scan_security[] = { "Open", "WEP", "WPA TKIP", "WPA2 AES", "WPA WPA2" };
+
+static response_frame_t frame(const char *name, const char *prefix, const std::string &data)
+{
+    response_frame_t f = { name, prefix, data };
+    /* The module stuffs its responses to a whole number of words, the
+     * leading "\r\n" dropped by BufferedSpi being one */
+    if (f.frame.size() & 1) {
+        f.frame += (char)0x15;
+    }
+    return f;
+}
+
+std::vector<response_frame_t> response_frames(void)
+{
+    std::vector<response_frame_t> frames;
+    char line[128];
+
+    frames.push_back(frame("status", "C?",
+                           "ssid,password,3,1,0,192.168.1.20,255.255.255.0,192.168.1.1,8.8.8.8,0.0.0.0,5,0,0,US,1" FRAME_OK));
+    frames.push_back(frame("rssi", "CR", "-52" FRAME_OK));
+    frames.push_back(frame("version", "I?",
+                           "ISM43362-M3G-L44-SPI,C3.5.2.5.STM,v3.5.2,v1.4.0.rc1,v8.2.1,120000000,Inventek eS-WiFi" FRAME_OK));
+    frames.push_back(frame("mac", "Z5", "C4:7F:51:8E:12:34" FRAME_OK));
+
+    std::string scan;
+    for (int i = 0; i < 10; i++) {
+        snprintf(line, sizeof(line), "#%03d,\"access-point-%d\",C4:7F:51:00:00:%02X,%d,72.20,Infrastructure,%s,2.4GHz,%d\r\n",
+                 i + 1, i, i, -40 - 4 * i, scan_security[i % 5], 1 + (i * 5) % 13);
+        scan += line;
+    }
+    frames.push_back(frame("scan", "F0", scan.substr(0, scan.size() - 2) + FRAME_OK));
+
+    /* Binary payload, with bytes looking like the framing */
+    std::string payload;
+    for (int i = 0; i < 1199; i++) {
+        static const char specials[] = { 0x15, '\r', '\n', '>', ' ', 'O', 'K', 0 };
+        payload += (i % 37 == 0) ? specials[(i / 37) % 8] : (char)((i * 131) & 0xFF);
+    }
+    frames.push_back(frame("recv", "R0", payload + FRAME_OK));
+    frames.push_back(frame("recv_empty", "R0", "OK\r\n> "));
+
+    frames.push_back(frame("socket", "P?", "0,192.168.1.20,0,192.168.1.10,8080,0,1,0,1,0,0" FRAME_OK));
+    frames.push_back(frame("accept", "MR", "[SOMA]Accepted 192.168.1.10:50000[EOMA]" FRAME_OK));
+    frames.push_back(frame("dns", "D0", "93.184.216.34" FRAME_OK));
+    frames.push_back(frame("error", "P6", "ERROR\r\nUsage: P6=<0|1>\r\n> "));
+
+    return frames;
+}
+
+int response_frames_load(const char *path, std::vector<response_frame_t> &frames)
+{
+    FILE *file = fopen(path, "rb");
+    uint8_t header[SPIRECORDER_HEADER_SIZE];
+    int count = 0;
+
+    if (file == NULL) {
+        return -1;
+    }
+
+    /* Records are: type, status, length (16 bits), timestamp (32 bits), payload */
+    while (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+        uint32_t len = header[2] | (header[3] << 8);
+        std::string payload(len, 0);
+        if (len > 0 && fread(&payload[0], 1, len, file) != len) {
+            break;
+        }
+        if (header[0] == SpiRecorder::Rx) {
+            response_frame_t f = { "recorded", NULL, payload };
+            frames.push_back(f);
+            count++;
+        }
+    }
+
+    fclose(file);
+    return count;
+}
@@ -0,0 +1,43 @@
+/* Module response frames for the parser benchmark and fuzz harness
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RESPONSE_FRAMES_H
+#define RESPONSE_FRAMES_H
+
+#include <string>
+#include <vector>
+
+/** Response of the module to one command, as stored in the receive buffer
+ */
+typedef struct {
+    const char *name;   /*!< response type */
+    const char *prefix; /*!< command answered with the frame */
+    std::string frame;  /*!< frame, without the leading "\r\n" */
+} response_frame_t;
+
+/** Typical responses: C? line, scan results, binary payload with 0x15
+ *  padding, socket status, accept message...
+ */
+std::vector<response_frame_t> response_frames(void);
+
+/** Rx frames of a SpiRecorder dump
+ *  @param path file holding the dump
+ *  @param frames recorded frames are appended here, with a NULL prefix
+ *  @return number of frames read, negative if the file cannot be read
+ */
+int response_frames_load(const char *path, std::vector<response_frame_t> &frames);
+
+#endif
@@ -0,0 +1,203 @@
+/* Conversion of an ATTrace capture to Chrome trace JSON
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ATTrace.h"
+
+// Size of the header of a capture: magic, version, name and event counts
+#define CAPTURE_HEADER_SIZE 12
+
+// Size of an event in a capture
+#define CAPTURE_EVENT_SIZE 8
+
+// Events of the self check, more than its ring holds
+#define CHECK_RING_SIZE 8
+#define CHECK_EVENTS 12
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: %s\r\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+/* The target writes its capture little endian, whatever the host */
+static uint32_t get_le(const uint8_t *p, int size)
+{
+    uint32_t value = 0;
+
+    for (int i = size - 1; i >= 0; i--) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+/* Convert a capture written by ATTrace::dump, returns false if it is malformed */
+static bool convert(const std::vector<uint8_t> &capture, std::string *json)
+{
+    const uint8_t *p = capture.data();
+    const uint8_t *end = p + capture.size();
+
+    if ((capture.size() < CAPTURE_HEADER_SIZE) || (get_le(p, 4) != ATTRACE_MAGIC)
+            || (get_le(p + 4, 2) != ATTRACE_VERSION)) {
+        return false;
+    }
+    uint32_t name_count = get_le(p + 6, 2);
+    uint32_t count = get_le(p + 8, 4);
+    p += CAPTURE_HEADER_SIZE;
+
+    std::vector<std::string> names;
+    for (uint32_t i = 0; i < name_count; i++) {
+        const uint8_t *nul = std::find(p, end, 0);
+        if (nul == end) {
+            return false;
+        }
+        names.push_back(std::string((const char *)p, nul - p));
+        p = nul + 1;
+    }
+    if ((uint32_t)(end - p) != count * CAPTURE_EVENT_SIZE) {
+        return false;
+    }
+
+    char line[160];
+    *json = "{\"traceEvents\":[\r\n";
+    for (uint32_t i = 0; i < count; i++, p += CAPTURE_EVENT_SIZE) {
+        uint8_t name = p[4];
+        snprintf(line, sizeof(line),
+                 "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,\"pid\":0,\"tid\":%u}%s\r\n",
+                 (name < names.size()) ? names[name].c_str() : "unknown", p[6],
+                 (unsigned long)get_le(p, 4), p[5], (i + 1 < count) ? "," : "");
+        *json += line;
+    }
+    *json += "]}\r\n";
+    return true;
+}
+
+static void capture_append(std::vector<uint8_t> *capture, const void *data, uint32_t size)
+{
+    capture->insert(capture->end(), (const uint8_t *)data, (const uint8_t *)data + size);
+}
+
+static void traced_thread(void)
+{
+    ATTrace::begin("other");
+    ATTrace::end("other");
+}
+
+/* Record a trace that wraps its ring, from two threads, and convert it */
+static void self_check(void)
+{
+    static attrace_event_t ring[CHECK_RING_SIZE];
+    std::vector<uint8_t> capture;
+    std::string json;
+
+    ATTrace::start(ring, CHECK_RING_SIZE);
+    for (int i = 0; i < (CHECK_EVENTS - 2) / 2; i++) {
+        ATTraceScope scope("first");
+    }
+    std::thread(traced_thread).join();
+    ATTrace::stop();
+    CHECK(ATTrace::dump(callback(&capture, capture_append)) == CHECK_RING_SIZE);
+    CHECK(sizeof(attrace_event_t) == CAPTURE_EVENT_SIZE);
+    CHECK(capture.size() == CAPTURE_HEADER_SIZE + sizeof("first") + sizeof("other")
+          + CHECK_RING_SIZE * CAPTURE_EVENT_SIZE);
+
+    CHECK(convert(capture, &json));
+    /* the oldest events were overwritten, the last ones ran in another thread */
+    CHECK(json.find("{\"name\":\"first\",\"ph\":\"B\"") != std::string::npos);
+    CHECK(json.find("{\"name\":\"other\",\"ph\":\"B\"") != std::string::npos);
+    CHECK(json.find("\"tid\":1},\r\n{\"name\":\"other\",\"ph\":\"E\"") != std::string::npos);
+    size_t events = 0;
+    for (size_t at = json.find("\"ph\""); at != std::string::npos; at = json.find("\"ph\"", at + 1)) {
+        events++;
+    }
+    CHECK(events == CHECK_RING_SIZE);
+    CHECK(json.compare(json.size() - 7, 7, "}\r\n]}\r\n") == 0);
+
+    /* a capture cut short is rejected */
+    capture.pop_back();
+    CHECK(!convert(capture, &json));
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [-i capture] [-o trace.json]\r\n", name);
+    printf("  Converts a capture written by ATTrace::dump to Chrome trace JSON,\r\n");
+    printf("  to stdout or the -o file. Without -i, checks the conversion\r\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    const char *output = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:o:h")) != -1) {
+        switch (opt) {
+            case 'i':
+                input = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if (input == NULL) {
+        self_check();
+        printf("%s: %d failure(s)\r\n", failures ? "FAILED" : "PASSED", failures);
+        return failures ? 1 : 0;
+    }
+
+    std::vector<uint8_t> capture;
+    std::string json;
+    FILE *f = fopen(input, "rb");
+    uint8_t buf[1024];
+    size_t n;
+
+    if (f == NULL) {
+        perror(input);
+        return 2;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        capture.insert(capture.end(), buf, buf + n);
+    }
+    fclose(f);
+
+    if (!convert(capture, &json)) {
+        fprintf(stderr, "%s: not an ATTrace capture\r\n", input);
+        return 1;
+    }
+
+    f = output ? fopen(output, "wb") : stdout;
+    if ((f == NULL) || (fwrite(json.data(), 1, json.size(), f) != json.size())) {
+        perror(output ? output : "stdout");
+        return 2;
+    }
+    if (output) {
+        fclose(f);
+    }
+    return 0;
+}
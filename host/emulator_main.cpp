@@ -0,0 +1,315 @@
+/* ISM43362 driver run against the emulated module
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include "FaultTransport.h"
+#include "ISM43362.h"
+#include "ISM43362Emulator.h"
+
+// Pin of the emulated module reset line
+#define EMULATOR_RESET_PIN 1
+
+// Pins of the serial line to the emulated module, with -u
+#define EMULATOR_UART_TX 2
+#define EMULATOR_UART_RX 3
+
+// Max time waiting for data from the peer
+#define EMULATOR_RECV_TIMEOUT 5000 /* milliseconds */
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: %s\r\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+/* Loopback peers of the emulated sockets */
+
+static int peer_bind(int type, int *port)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int fd = socket(AF_INET, type, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+            || getsockname(fd, (struct sockaddr *)&addr, &len) < 0) {
+        perror("bind");
+        exit(2);
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static void tcp_echo(int fd)
+{
+    char buf[2048];
+    int client = accept(fd, NULL, NULL);
+    ssize_t n;
+
+    while ((n = recv(client, buf, sizeof(buf), 0)) > 0) {
+        send(client, buf, n, MSG_NOSIGNAL);
+    }
+    close(client);
+    close(fd);
+}
+
+static void udp_echo(int fd)
+{
+    char buf[2048];
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    ssize_t n;
+
+    while ((n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&addr, &len)) > 0) {
+        sendto(fd, buf, n, 0, (struct sockaddr *)&addr, len);
+    }
+    close(fd);
+}
+
+/* Sends size bytes in packets and reads them back, returns the bytes echoed */
+static uint32_t echo(ISM43362 &wifi, int id, uint32_t size, uint32_t packet, uint32_t *latency_us)
+{
+    static char tx[ES_WIFI_MAX_RX_PACKET_SIZE];
+    static char rx[ES_WIFI_RX_BUFFER_SIZE];
+    uint32_t done = 0;
+    uint32_t latency = 0;
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < sizeof(tx); i++) {
+        tx[i] = (char)('a' + i % 26);
+    }
+
+    while (done < size) {
+        uint32_t len = MIN(packet, size - done);
+        uint32_t start = us_ticker_read();
+        uint32_t got = 0;
+
+        if (!wifi.send(id, tx, len)) {
+            break;
+        }
+        while (got < len) {
+            int n = wifi.check_recv_status(id, rx);
+            if (n < 0 || (n == 0 && (us_ticker_read() - start) / 1000 > EMULATOR_RECV_TIMEOUT)) {
+                return done;
+            }
+            if (n > 0 && memcmp(rx, tx + got, n) != 0) {
+                printf("FAIL echo mismatch at %lu\r\n", (unsigned long)(done + got));
+                failures++;
+                return done;
+            }
+            got += n;
+        }
+        latency += us_ticker_read() - start;
+        count++;
+        done += len;
+    }
+
+    if (latency_us != NULL) {
+        *latency_us = count ? latency / count : 0;
+    }
+    return done;
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [-u] [-l latency_us] [-f spi_hz] [-n bytes] [-p packet]\r\n", name);
+    printf("  Runs the driver against the emulated module, then the echo throughput benchmark\r\n");
+    printf("  -u runs the driver over BufferedUart, the module being on a pty\r\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t latency_us = 0;
+    uint32_t spi_hz = 0;
+    uint32_t bench_size = 64 * 1024;
+    uint32_t packet = ES_WIFI_MAX_RX_PACKET_SIZE;
+    bool uart = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "ul:f:n:p:h")) != -1) {
+        switch (opt) {
+            case 'u':
+                uart = true;
+                break;
+            case 'l':
+                latency_us = atoi(optarg);
+                break;
+            case 'f':
+                spi_hz = atoi(optarg);
+                break;
+            case 'n':
+                bench_size = atoi(optarg);
+                break;
+            case 'p':
+                packet = MIN((uint32_t)atoi(optarg), (uint32_t)ES_WIFI_MAX_RX_PACKET_SIZE);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    ISM43362Emulator *module = new ISM43362Emulator(EMULATOR_RESET_PIN);
+    module->set_timing(latency_us, spi_hz);
+    ISM43362 *link;
+    if (uart) {
+        /* The module is on the master side of a pty, the driver on the slave one */
+        int master = posix_openpt(O_RDWR | O_NOCTTY);
+        if ((master < 0) || (grantpt(master) < 0) || (unlockpt(master) < 0)) {
+            perror("pty");
+            return 2;
+        }
+        int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+        if (slave < 0) {
+            perror("pty");
+            return 2;
+        }
+        module->serve_uart(master);
+        host_serial_attach(EMULATOR_UART_TX, slave);
+        link = new ISM43362(EMULATOR_UART_TX, EMULATOR_UART_RX, EMULATOR_RESET_PIN, NC);
+    } else {
+        link = new ISM43362(module, EMULATOR_RESET_PIN, NC);
+    }
+    ISM43362 &wifi = *link;
+
+    /* Module information and network */
+    const char *version = wifi.get_firmware_version();
+    CHECK(version != NULL && strcmp(version, "C3.5.2.5.STM") == 0);
+    const char *mac = wifi.getMACAddress();
+    CHECK(mac != NULL && strcmp(mac, "02:00:00:43:62:00") == 0);
+    CHECK(!wifi.isConnected() || strcmp(wifi.getIPAddress(), "0.0.0.0") == 0);
+    CHECK(wifi.dhcp(true));
+    CHECK(wifi.connect("emulator", "password"));
+    const char *ip = wifi.getIPAddress();
+    CHECK(ip != NULL && strcmp(ip, "127.0.0.1") == 0);
+    const char *netmask = wifi.getNetmask();
+    CHECK(netmask != NULL && strcmp(netmask, "255.0.0.0") == 0);
+    CHECK(wifi.getRSSI() == -40);
+    uint8_t bssid[6];
+    CHECK(wifi.getBSSID(bssid) && bssid[5] == 0x01);
+
+    WiFiAccessPoint ap[4];
+    CHECK(wifi.scan(ap, 4) == 1);
+    CHECK(strcmp(ap[0].get_ssid(), "emulator") == 0 && ap[0].get_channel() == 6);
+    CHECK(memcmp(ap[0].get_bssid(), bssid, sizeof(bssid)) == 0 && ap[0].get_rssi() == -40);
+
+    char addr[NSAPI_IP_SIZE];
+    CHECK(wifi.dns_lookup("localhost", addr) && strcmp(addr, "127.0.0.1") == 0);
+
+    /* TCP client */
+    int port;
+    int fd = peer_bind(SOCK_STREAM, &port);
+    listen(fd, 1);
+    std::thread tcp_peer(tcp_echo, fd);
+    CHECK(wifi.open("0", 0, "127.0.0.1", port));
+    CHECK(echo(wifi, 0, 3000, 1000, NULL) == 3000);
+    CHECK(wifi.socket_status(0) == 1);
+
+    /* After a fault, the link is recovered once a socket works again, not at
+     * the next successful command */
+    FaultTransport faults;
+    FaultTransport::Stats fault_stats;
+    wifi.set_fault_injection(&faults);
+    faults.set_fault(FaultTransport::FailWrite, 1000);
+    wifi.getRSSI();
+    faults.set_fault(FaultTransport::FailWrite, 0);
+    CHECK(wifi.getRSSI() == -40);
+    faults.get_stats(&fault_stats);
+    CHECK(fault_stats.injected[FaultTransport::FailWrite] > 0 && fault_stats.recoveries == 0);
+    CHECK(echo(wifi, 0, 100, 100, NULL) == 100);
+    faults.get_stats(&fault_stats);
+    CHECK(fault_stats.recoveries == 1);
+    wifi.set_fault_injection(NULL);
+
+    /* UDP client */
+    fd = peer_bind(SOCK_DGRAM, &port);
+    std::thread udp_peer(udp_echo, fd);
+    CHECK(wifi.open("1", 1, "127.0.0.1", port));
+    CHECK(echo(wifi, 1, 2000, 500, NULL) == 2000);
+
+    /* TCP server, the accepted client is served on the same id */
+    fd = peer_bind(SOCK_STREAM, &port);
+    close(fd);
+    CHECK(wifi.open_server("0", 2, port));
+    char peer_ip[16];
+    int peer_port = 0;
+    CHECK(wifi.accept(2, peer_ip, &peer_port) == 0);
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    CHECK(connect(client, (struct sockaddr *)&server, sizeof(server)) == 0);
+    CHECK(wifi.accept(2, peer_ip, &peer_port) == 1 && strcmp(peer_ip, "127.0.0.1") == 0);
+    CHECK(send(client, "ping", 4, 0) == 4);
+    char rx[ES_WIFI_RX_BUFFER_SIZE];
+    int n = 0;
+    uint32_t start = us_ticker_read();
+    while (n == 0 && (us_ticker_read() - start) / 1000 < EMULATOR_RECV_TIMEOUT) {
+        n = wifi.check_recv_status(2, rx);
+    }
+    CHECK(n == 4 && memcmp(rx, "ping", 4) == 0);
+    CHECK(wifi.send(2, "pong", 4));
+    char pong[4];
+    CHECK(recv(client, pong, sizeof(pong), MSG_WAITALL) == 4 && memcmp(pong, "pong", 4) == 0);
+    close(client);
+    CHECK(wifi.close(2));
+    CHECK(wifi.close_server(2));
+
+    /* Throughput and round trip latency of the TCP echo */
+    uint32_t round_trip = 0;
+    uint32_t commands = module->commands();
+    start = us_ticker_read();
+    uint32_t done = echo(wifi, 0, bench_size, packet, &round_trip);
+    uint32_t elapsed = us_ticker_read() - start;
+    CHECK(done == bench_size);
+    printf("echo %lu bytes in %lu us: %lu kB/s, round trip %lu us, %lu commands\r\n",
+           (unsigned long)done, (unsigned long)elapsed,
+           (unsigned long)(elapsed ? ((uint64_t)done * 1000 / elapsed) : 0),
+           (unsigned long)round_trip, (unsigned long)(module->commands() - commands));
+
+    /* A reset closes the sockets and leaves the network */
+    CHECK(wifi.reset());
+    CHECK(!wifi.send(0, "x", 1));
+    CHECK(wifi.getIPAddress() != NULL && strcmp(wifi.getIPAddress(), "0.0.0.0") == 0);
+
+    /* The TCP peer sees its connection closed, the UDP one runs until exit */
+    tcp_peer.join();
+    udp_peer.detach();
+    delete link;
+    if (uart) {
+        /* the driver only owns its SPI link */
+        delete module;
+    }
+
+    printf("%s: %d failure(s)\r\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
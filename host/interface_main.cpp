@@ -0,0 +1,443 @@
+/* ISM43362Interface and benchmark run against the emulated module
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "ISM43362Interface.h"
+#include "ISM43362Emulator.h"
+#include "ISM43362Benchmark.h"
+
+// Pin of the emulated module reset line
+#define EMULATOR_RESET_PIN 1
+
+// Pin of the reset line of the modules of the roaming runs
+#define ROAMING_RESET_PIN 4
+
+// RSSI monitor period and time given to the background scan of a roaming run
+#define ROAMING_SAMPLE_PERIOD 50 /* milliseconds */
+#define ROAMING_RUN_TIME 500 /* milliseconds */
+
+// Max time waiting for data from the peer
+#define INTERFACE_RECV_TIMEOUT 5000 /* milliseconds */
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: %s\r\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+/* Loopback peers of the sockets, serving each connection until it closes */
+
+typedef enum {
+    PEER_ECHO,
+    PEER_DISCARD,
+    PEER_SOURCE,
+} peer_mode_t;
+
+static int peer_bind(int type, int *port)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int fd = socket(AF_INET, type, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+            || getsockname(fd, (struct sockaddr *)&addr, &len) < 0) {
+        perror("bind");
+        exit(2);
+    }
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static void peer_serve(int client, peer_mode_t mode)
+{
+    char buf[2048];
+    ssize_t n;
+
+    if (mode == PEER_SOURCE) {
+        memset(buf, 'x', sizeof(buf));
+        while (send(client, buf, sizeof(buf), MSG_NOSIGNAL) > 0) {
+        }
+    } else {
+        while ((n = recv(client, buf, sizeof(buf), 0)) > 0) {
+            if (mode == PEER_ECHO) {
+                send(client, buf, n, MSG_NOSIGNAL);
+            }
+        }
+    }
+    close(client);
+}
+
+static void peer_listen(int fd, peer_mode_t mode, std::atomic<int> *connections)
+{
+    int client;
+
+    while ((client = accept(fd, NULL, NULL)) >= 0) {
+        if (connections) {
+            (*connections)++;
+        }
+        std::thread(peer_serve, client, mode).detach();
+    }
+}
+
+static int peer_start(peer_mode_t mode, std::atomic<int> *connections = NULL)
+{
+    int port;
+    int fd = peer_bind(SOCK_STREAM, &port);
+
+    listen(fd, 4);
+    std::thread(peer_listen, fd, mode, connections).detach();
+    return port;
+}
+
+/* Client connected to a server socket, with its local port */
+static int peer_connect(int port, int *local_port)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+            || getsockname(fd, (struct sockaddr *)&addr, &len) < 0) {
+        perror("connect");
+        exit(2);
+    }
+    *local_port = ntohs(addr.sin_port);
+    return fd;
+}
+
+static void udp_sink(int fd)
+{
+    char buf[2048];
+
+    while (recv(fd, buf, sizeof(buf), 0) >= 0) {
+    }
+}
+
+static void status_record(std::vector<intptr_t> *statuses, nsapi_event_t event, intptr_t status)
+{
+    if (event == NSAPI_EVENT_CONNECTION_STATUS_CHANGE) {
+        statuses->push_back(status);
+    }
+}
+
+static void roaming_switch(int *switches, bool start)
+{
+    if (!start) {
+        (*switches)++;
+    }
+}
+
+/* Run an interface joined to the first access point, averaging its RSSI at
+ * average_rssi, then enable roaming with the first access point at
+ * current_rssi and a second one at other_rssi, 0 if out of range.
+ * Returns the number of access point switches and the final RSSI */
+static int roaming_run(int average_rssi, int current_rssi, int other_rssi, int8_t *rssi)
+{
+    ISM43362Emulator *module = new ISM43362Emulator(ROAMING_RESET_PIN);
+    module->set_rssi(average_rssi, 0);
+    ISM43362Interface *wifi = new ISM43362Interface(module, ROAMING_RESET_PIN, NC);
+    int switches = 0;
+
+    wifi->attach_roaming(callback(&switches, roaming_switch));
+    CHECK(wifi->connect("emulator", "password", NSAPI_SECURITY_WPA2) == NSAPI_ERROR_OK);
+    CHECK(wifi->set_rssi_monitor(ROAMING_SAMPLE_PERIOD) == NSAPI_ERROR_OK);
+    wait_ms(4 * ROAMING_SAMPLE_PERIOD);
+    module->set_rssi(current_rssi, 0);
+    module->set_rssi(other_rssi, 1);
+    /* The average stays below the threshold for the next samples */
+    CHECK(wifi->set_roaming(average_rssi + 5, 8, ROAMING_SAMPLE_PERIOD) == NSAPI_ERROR_OK);
+    wait_ms(ROAMING_RUN_TIME);
+    *rssi = wifi->get_rssi();
+    CHECK(wifi->get_connection_status() == NSAPI_STATUS_GLOBAL_UP);
+    delete wifi;
+    return switches;
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [-l latency_us] [-f spi_hz] [-n bytes] [-c count]\r\n", name);
+    printf("  Runs the interface against the emulated module, then the benchmark\r\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t latency_us = 0;
+    uint32_t spi_hz = 0;
+    uint32_t bench_size = 64 * 1024;
+    uint32_t bench_count = 50;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:f:n:c:h")) != -1) {
+        switch (opt) {
+            case 'l':
+                latency_us = atoi(optarg);
+                break;
+            case 'f':
+                spi_hz = atoi(optarg);
+                break;
+            case 'n':
+                bench_size = atoi(optarg);
+                break;
+            case 'c':
+                bench_count = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    ISM43362Emulator *module = new ISM43362Emulator(EMULATOR_RESET_PIN);
+    module->set_timing(latency_us, spi_hz);
+    ISM43362Interface *wifi = new ISM43362Interface(module, EMULATOR_RESET_PIN, NC);
+
+    /* Network */
+    CHECK(wifi->connect("emulator", "password", NSAPI_SECURITY_WPA2) == NSAPI_ERROR_OK);
+    CHECK(wifi->get_connection_status() == NSAPI_STATUS_GLOBAL_UP);
+    CHECK(wifi->get_ip_address() != NULL && strcmp(wifi->get_ip_address(), "127.0.0.1") == 0);
+    CHECK(wifi->get_rssi() == -40);
+
+    SocketAddress address;
+    CHECK(wifi->gethostbyname("localhost", &address) == NSAPI_ERROR_OK);
+    CHECK(address.get_ip_address() != NULL && strcmp(address.get_ip_address(), "127.0.0.1") == 0);
+
+    /* TCP client, with a message sent in several parts */
+    int echo_port = peer_start(PEER_ECHO);
+    TCPSocket tcp;
+    CHECK(tcp.open(wifi) == NSAPI_ERROR_OK);
+    tcp.set_timeout(INTERFACE_RECV_TIMEOUT);
+    CHECK(tcp.connect(SocketAddress("127.0.0.1", echo_port)) == NSAPI_ERROR_OK);
+    char tx[3000];
+    char rx[sizeof(tx)];
+    for (uint32_t i = 0; i < sizeof(tx); i++) {
+        tx[i] = (char)('a' + i % 26);
+    }
+    uint32_t sent = 0;
+    while (sent < sizeof(tx)) {
+        int n = tcp.send(tx + sent, sizeof(tx) - sent);
+        CHECK(n > 0);
+        if (n <= 0) {
+            break;
+        }
+        sent += n;
+    }
+    uint32_t received = 0;
+    while (received < sent) {
+        int n = tcp.recv(rx + received, sizeof(rx) - received);
+        CHECK(n > 0);
+        if (n <= 0) {
+            break;
+        }
+        received += n;
+    }
+    CHECK(received == sizeof(tx) && memcmp(rx, tx, sizeof(tx)) == 0);
+    /* The socket read thread polls with the read timeout of the socket */
+    wait_ms(100);
+    int read_timeout = 0;
+    unsigned size = sizeof(read_timeout);
+    CHECK(tcp.getsockopt(ISM43362_SOCKET_LEVEL, ISM43362_RCVTIMEO, &read_timeout, &size) == NSAPI_ERROR_OK);
+    bool read_timeout_set = false;
+    for (int i = 0; i < ISM43362_EMULATOR_SOCKETS; i++) {
+        read_timeout_set = read_timeout_set || (module->read_timeout(i) == read_timeout);
+    }
+    CHECK(read_timeout_set);
+
+    /* The standard options set the ISM43362 ones */
+    int value = 2000;
+    CHECK(tcp.setsockopt(NSAPI_SOCKET, NSAPI_KEEPIDLE, &value, sizeof(value)) == NSAPI_ERROR_OK);
+    value = 1;
+    CHECK(tcp.setsockopt(NSAPI_SOCKET, NSAPI_KEEPALIVE, &value, sizeof(value)) == NSAPI_ERROR_OK);
+    size = sizeof(value);
+    CHECK(tcp.getsockopt(ISM43362_SOCKET_LEVEL, ISM43362_KEEPALIVE, &value, &size) == NSAPI_ERROR_OK && value == 2000);
+    value = 512;
+    CHECK(tcp.setsockopt(NSAPI_SOCKET, NSAPI_SNDBUF, &value, sizeof(value)) == NSAPI_ERROR_OK);
+    value = 256;
+    CHECK(tcp.setsockopt(NSAPI_SOCKET, NSAPI_RCVBUF, &value, sizeof(value)) == NSAPI_ERROR_OK);
+    CHECK(tcp.getsockopt(ISM43362_SOCKET_LEVEL, ISM43362_SNDBUF, &value, &size) == NSAPI_ERROR_OK && value == 512);
+    CHECK(tcp.getsockopt(NSAPI_SOCKET, NSAPI_RCVBUF, &value, &size) == NSAPI_ERROR_OK && value == 256);
+    value = 0;
+    CHECK(tcp.setsockopt(NSAPI_SOCKET, NSAPI_KEEPALIVE, &value, sizeof(value)) == NSAPI_ERROR_OK);
+    CHECK(tcp.getsockopt(NSAPI_SOCKET, NSAPI_KEEPALIVE, &value, &size) == NSAPI_ERROR_OK && value == 0);
+    CHECK(tcp.getsockopt(NSAPI_SOCKET, NSAPI_KEEPIDLE, &value, &size) == NSAPI_ERROR_OK && value == 2000);
+    CHECK(tcp.close() == NSAPI_ERROR_OK);
+
+    /* Connection pool: a connection is reused with the settings of its new
+     * socket, and only kept while it is up */
+    std::atomic<int> connections(0);
+    int pool_port = peer_start(PEER_ECHO, &connections);
+    CHECK(wifi->set_connection_pool(true, INTERFACE_RECV_TIMEOUT) == NSAPI_ERROR_OK);
+    int keepalive = 1000;
+    CHECK(tcp.open(wifi) == NSAPI_ERROR_OK);
+    tcp.set_timeout(INTERFACE_RECV_TIMEOUT);
+    CHECK(tcp.setsockopt(ISM43362_SOCKET_LEVEL, ISM43362_KEEPALIVE, &keepalive, sizeof(keepalive)) == NSAPI_ERROR_OK);
+    CHECK(tcp.connect(SocketAddress("127.0.0.1", pool_port)) == NSAPI_ERROR_OK);
+    CHECK(tcp.send("ka", 2) == 2 && tcp.recv(rx, 2) == 2);
+    /* applied by the socket read thread */
+    wait_ms(100);
+    bool keepalive_on = false;
+    for (int i = 0; i < ISM43362_EMULATOR_SOCKETS; i++) {
+        keepalive_on = keepalive_on || module->keepalive(i);
+    }
+    CHECK(keepalive_on);
+    CHECK(tcp.close() == NSAPI_ERROR_OK);
+    CHECK(tcp.open(wifi) == NSAPI_ERROR_OK);
+    tcp.set_timeout(INTERFACE_RECV_TIMEOUT);
+    CHECK(tcp.connect(SocketAddress("127.0.0.1", pool_port)) == NSAPI_ERROR_OK);
+    CHECK(tcp.send("nk", 2) == 2 && tcp.recv(rx, 2) == 2);
+    CHECK(connections == 1);
+    wait_ms(100);
+    keepalive_on = false;
+    for (int i = 0; i < ISM43362_EMULATOR_SOCKETS; i++) {
+        keepalive_on = keepalive_on || module->keepalive(i);
+    }
+    CHECK(!keepalive_on);
+    CHECK(tcp.close() == NSAPI_ERROR_OK);
+    CHECK(wifi->set_connection_pool(false) == NSAPI_ERROR_OK);
+
+    /* TCP server */
+    int port;
+    int fd = peer_bind(SOCK_STREAM, &port);
+    close(fd);
+    TCPServer server;
+    CHECK(server.open(wifi) == NSAPI_ERROR_OK);
+    CHECK(server.bind(port) == NSAPI_ERROR_OK);
+    CHECK(server.listen() == NSAPI_ERROR_OK);
+    server.set_timeout(INTERFACE_RECV_TIMEOUT);
+    int client_port;
+    int client = peer_connect(port, &client_port);
+    TCPSocket accepted;
+    SocketAddress peer;
+    CHECK(server.accept(&accepted, &peer) == NSAPI_ERROR_OK);
+    CHECK(peer.get_ip_address() != NULL && strcmp(peer.get_ip_address(), "127.0.0.1") == 0);
+    CHECK(peer.get_port() == client_port);
+    accepted.set_timeout(INTERFACE_RECV_TIMEOUT);
+    CHECK(send(client, "ping", 4, 0) == 4);
+    CHECK(accepted.recv(rx, 4) == 4 && memcmp(rx, "ping", 4) == 0);
+    CHECK(accepted.send("pong", 4) == 4);
+    CHECK(recv(client, rx, 4, MSG_WAITALL) == 4 && memcmp(rx, "pong", 4) == 0);
+    /* The closed connection is found by the liveness check, after its data */
+    CHECK(send(client, "bye", 3, 0) == 3);
+    close(client);
+    CHECK(accepted.recv(rx, sizeof(rx)) == 3 && memcmp(rx, "bye", 3) == 0);
+    CHECK(accepted.recv(rx, sizeof(rx)) == NSAPI_ERROR_CONNECTION_LOST);
+    CHECK(accepted.close() == NSAPI_ERROR_OK);
+    CHECK(server.close() == NSAPI_ERROR_OK);
+
+    /* Two servers, accepting in the reverse order of the connections: the
+     * module accepts a client before any command, the D0 here */
+    int port2;
+    fd = peer_bind(SOCK_STREAM, &port2);
+    close(fd);
+    TCPServer server2;
+    CHECK(server2.open(wifi) == NSAPI_ERROR_OK);
+    CHECK(server2.bind(port2) == NSAPI_ERROR_OK);
+    CHECK(server2.listen() == NSAPI_ERROR_OK);
+    server2.set_timeout(INTERFACE_RECV_TIMEOUT);
+    CHECK(server.open(wifi) == NSAPI_ERROR_OK);
+    CHECK(server.bind(port) == NSAPI_ERROR_OK);
+    CHECK(server.listen() == NSAPI_ERROR_OK);
+    client = peer_connect(port, &client_port);
+    CHECK(wifi->gethostbyname("localhost", &address) == NSAPI_ERROR_OK);
+    int client2_port;
+    int client2 = peer_connect(port2, &client2_port);
+    CHECK(wifi->gethostbyname("localhost", &address) == NSAPI_ERROR_OK);
+    TCPSocket accepted2;
+    CHECK(server2.accept(&accepted2, &peer) == NSAPI_ERROR_OK);
+    CHECK(peer.get_port() == client2_port);
+    CHECK(server.accept(&accepted, &peer) == NSAPI_ERROR_OK);
+    CHECK(peer.get_port() == client_port);
+    close(client);
+    close(client2);
+    CHECK(accepted.close() == NSAPI_ERROR_OK);
+    CHECK(accepted2.close() == NSAPI_ERROR_OK);
+    CHECK(server.close() == NSAPI_ERROR_OK);
+    CHECK(server2.close() == NSAPI_ERROR_OK);
+
+    /* Roaming, deciding on the RSSI of both access points in the same scan,
+     * the current one not being a candidate */
+    int8_t rssi;
+    CHECK(roaming_run(-75, -75, -60, &rssi) == 1);
+    CHECK(rssi == -60);
+    CHECK(roaming_run(-75, -75, -70, &rssi) == 0);
+    CHECK(rssi == -75);
+    CHECK(roaming_run(-75, -60, 0, &rssi) == 0);
+    CHECK(rssi == -60);
+
+    /* Benchmark against the loopback peers */
+    ISM43362Benchmark bench(wifi);
+    int discard_port = peer_start(PEER_DISCARD);
+    int source_port = peer_start(PEER_SOURCE);
+    int udp_port;
+    fd = peer_bind(SOCK_DGRAM, &udp_port);
+    std::thread(udp_sink, fd).detach();
+
+    ism43362_bench_result_t res;
+    CHECK(bench.tcp_upload(SocketAddress("127.0.0.1", discard_port), bench_size, &res) == 0);
+    CHECK(res.bytes == bench_size);
+    CHECK(bench.tcp_download(SocketAddress("127.0.0.1", source_port), bench_size, &res) == 0);
+    CHECK(res.bytes == bench_size);
+    CHECK(bench.udp_send(SocketAddress("127.0.0.1", udp_port), bench_count, 512, &res) == 0);
+    CHECK(res.count == bench_count);
+    CHECK(bench.tcp_round_trip(SocketAddress("127.0.0.1", echo_port), bench_count, 32, &res) == 0);
+    CHECK(res.count == bench_count && res.min_us <= res.p50_us && res.p99_us <= res.max_us);
+    CHECK(bench.tcp_round_trip(SocketAddress("127.0.0.1", echo_port), 4, 1024, &res) == 0);
+    CHECK(res.bytes == 4 * 1024);
+    CHECK(bench.connect_time(SocketAddress("127.0.0.1", echo_port), 4, &res) == 0);
+    CHECK(res.count == 4);
+    CHECK(bench.dns_time("localhost", 4, &res) == 0);
+    CHECK(res.count == 4);
+
+    /* Status changes are reported in order, like the socket events */
+    std::vector<intptr_t> statuses;
+    EventQueue queue;
+    wifi->set_event_queue(&queue);
+    wifi->attach(callback(&statuses, status_record));
+    CHECK(wifi->disconnect() == NSAPI_ERROR_OK);
+    CHECK(wifi->get_connection_status() == NSAPI_STATUS_DISCONNECTED);
+    CHECK(wifi->connect() == NSAPI_ERROR_OK);
+    CHECK(statuses.empty());
+    queue.dispatch(0);
+    CHECK(statuses.size() == 3);
+    if (statuses.size() == 3) {
+        CHECK(statuses[0] == NSAPI_STATUS_DISCONNECTED);
+        CHECK(statuses[1] == NSAPI_STATUS_CONNECTING);
+        CHECK(statuses[2] == NSAPI_STATUS_GLOBAL_UP);
+    }
+    wifi->set_event_queue(NULL);
+    CHECK(wifi->disconnect() == NSAPI_ERROR_OK);
+    CHECK(statuses.size() == 4 && statuses.back() == NSAPI_STATUS_DISCONNECTED);
+    delete wifi;
+
+    printf("%s: %d failure(s)\r\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,99 @@
+/* Host build of the driver
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * mbed::Callback for the host build, on top of std::function
+ *
+ */
+#ifndef MBED_HOST_CALLBACK_H
+#define MBED_HOST_CALLBACK_H
+
+#include <functional>
+
+namespace mbed {
+
+template <typename F>
+class Callback;
+
+template <typename R, typename... A>
+class Callback<R(A...)>
+{
+public:
+    Callback(R (*func)(A...) = 0)
+    {
+        if (func) {
+            _func = func;
+        }
+    }
+
+    template <typename T, typename U>
+    Callback(U *obj, R (T::*method)(A...))
+    {
+        _func = [obj, method](A... args) -> R { return (obj->*method)(args...); };
+    }
+
+    template <typename T, typename U>
+    Callback(const U *obj, R (T::*method)(A...) const)
+    {
+        _func = [obj, method](A... args) -> R { return (obj->*method)(args...); };
+    }
+
+    template <typename T, typename U>
+    Callback(U *obj, R (*func)(T *, A...))
+    {
+        _func = [obj, func](A... args) -> R { return func(obj, args...); };
+    }
+
+    R call(A... args) const
+    {
+        return _func(args...);
+    }
+
+    R operator()(A... args) const
+    {
+        return call(args...);
+    }
+
+    operator bool() const
+    {
+        return static_cast<bool>(_func);
+    }
+
+private:
+    std::function<R(A...)> _func;
+};
+
+template <typename R, typename... A>
+Callback<R(A...)> callback(R (*func)(A...) = 0)
+{
+    return Callback<R(A...)>(func);
+}
+
+template <typename T, typename U, typename R, typename... A>
+Callback<R(A...)> callback(U *obj, R (T::*method)(A...))
+{
+    return Callback<R(A...)>(obj, method);
+}
+
+template <typename T, typename U, typename R, typename... A>
+Callback<R(A...)> callback(U *obj, R (*func)(T *, A...))
+{
+    return Callback<R(A...)>(obj, func);
+}
+
+}
+
+#endif
@@ -0,0 +1,260 @@
+/* Host build of the driver
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * Subset of the mbed OS API used by the module driver, implemented on Linux
+ *
+ * Only what ISM43362, ISM43362Interface and their transports need is
+ * provided. GPIOs are kept in a table: a test or an emulator watches a pin
+ * with host_gpio_attach() and drives an input with host_gpio_set(). A serial
+ * port runs on the file descriptor given to host_serial_attach(). The RTOS,
+ * events and network socket parts are in rtos.h, mbed_events.h and nsapi.h.
+ *
+ */
+#ifndef MBED_HOST_H
+#define MBED_HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <sys/types.h>
+#include <pthread.h>
+#include <mutex>
+#include "Callback.h"
+#include "mbed_debug.h"
+#include "mbed_error.h"
+
+typedef int PinName;
+#define NC (-1)
+
+extern "C" {
+uint32_t us_ticker_read(void);
+void wait_us(int us);
+void wait_ms(int ms);
+void wait(float s);
+void core_util_critical_section_enter(void);
+void core_util_critical_section_exit(void);
+}
+
+/** Set the level of a pin, as seen by DigitalIn, InterruptIn and the pin watchers
+ *  @param pin pin to drive
+ *  @param value 0 or 1, rise callbacks of the pin are called on 0 to 1
+ */
+void host_gpio_set(PinName pin, int value);
+
+/** Read the level of a pin
+ *  @param pin pin to read
+ *  @return last level written or set, 0 by default
+ */
+int host_gpio_get(PinName pin);
+
+/** Call a function whenever a pin is written by a DigitalOut
+ *  @param pin pin to watch
+ *  @param func called with the written value, NULL to stop watching
+ */
+void host_gpio_attach(PinName pin, mbed::Callback<void(int)> func);
+
+/** Connect the serial port of a transmit pin to a file descriptor, e.g. a pty
+ *
+ *  A RawSerial created afterwards on this pin reads and writes the file
+ *  descriptor, its receive interrupt being called from a thread of its own.
+ *  @param tx transmit pin of the serial port
+ *  @param fd file descriptor, -1 to disconnect
+ */
+void host_serial_attach(PinName tx, int fd);
+
+namespace mbed {
+
+class DigitalOut
+{
+public:
+    DigitalOut(PinName pin) : _pin(pin) {}
+    DigitalOut(PinName pin, int value) : _pin(pin)
+    {
+        write(value);
+    }
+    void write(int value);
+    int read(void)
+    {
+        return host_gpio_get(_pin);
+    }
+    DigitalOut &operator=(int value)
+    {
+        write(value);
+        return *this;
+    }
+    operator int()
+    {
+        return read();
+    }
+
+private:
+    PinName _pin;
+};
+
+class DigitalIn
+{
+public:
+    DigitalIn(PinName pin) : _pin(pin) {}
+    int read(void)
+    {
+        return host_gpio_get(_pin);
+    }
+    operator int()
+    {
+        return read();
+    }
+
+private:
+    PinName _pin;
+};
+
+class InterruptIn
+{
+public:
+    InterruptIn(PinName pin);
+    ~InterruptIn();
+    void rise(Callback<void()> func)
+    {
+        _rise = func;
+    }
+    void fall(Callback<void()> func)
+    {
+        _fall = func;
+    }
+    int read(void)
+    {
+        return host_gpio_get(_pin);
+    }
+
+    /* called by host_gpio_set */
+    void edge(int value)
+    {
+        if (value && _rise) {
+            _rise();
+        } else if (!value && _fall) {
+            _fall();
+        }
+    }
+    PinName pin(void) const
+    {
+        return _pin;
+    }
+
+private:
+    PinName _pin;
+    Callback<void()> _rise;
+    Callback<void()> _fall;
+};
+
+/** SPI master with nothing connected, reads return 0xFFFF
+ */
+class SPI
+{
+public:
+    SPI(PinName mosi, PinName miso, PinName sclk, PinName ssel = NC) {}
+    void format(int bits, int mode = 0) {}
+    void frequency(int hz = 1000000) {}
+    int write(int value)
+    {
+        return 0xFFFF;
+    }
+};
+
+/** Serial port on the file descriptor attached to its transmit pin, with
+ *  nothing connected if there is none, see host_serial_attach()
+ */
+class RawSerial
+{
+public:
+    enum IrqType {
+        RxIrq = 0,
+        TxIrq
+    };
+    RawSerial(PinName tx, PinName rx, int baud = 9600);
+    ~RawSerial();
+    void baud(int baudrate) {}
+    int putc(int c);
+    int getc(void);
+    int readable(void);
+    int writeable(void)
+    {
+        return 1;
+    }
+    void attach(Callback<void()> func, IrqType type = RxIrq);
+
+private:
+    int _fd;
+    pthread_t _thread;
+    volatile bool _stop;
+    std::mutex _mutex;
+    Callback<void()> _irq[2];
+
+    static void *rx_thread(void *serial);
+};
+
+class Timer
+{
+public:
+    Timer() : _running(false), _start(0), _elapsed(0) {}
+    void start(void)
+    {
+        if (!_running) {
+            _start = us_ticker_read();
+            _running = true;
+        }
+    }
+    void stop(void)
+    {
+        _elapsed = read_us();
+        _running = false;
+    }
+    void reset(void)
+    {
+        _start = us_ticker_read();
+        _elapsed = 0;
+    }
+    int read_us(void)
+    {
+        return _elapsed + (_running ? (us_ticker_read() - _start) : 0);
+    }
+    int read_ms(void)
+    {
+        return read_us() / 1000;
+    }
+    float read(void)
+    {
+        return read_us() / 1000000.0f;
+    }
+
+private:
+    bool _running;
+    uint32_t _start;
+    uint32_t _elapsed;
+};
+
+}
+
+using namespace mbed;
+
+#include "rtos.h"
+#include "mbed_events.h"
+#include "nsapi.h"
+
+#endif
@@ -0,0 +1,30 @@
+/* Host build of the driver
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MBED_HOST_ERROR_H
+#define MBED_HOST_ERROR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Print the message and abort */
+void error(const char *format, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,108 @@
+/* Host build of the driver
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * Subset of the mbed OS events API
+ *
+ * Like the mbed one, a queue holds size / EVENTS_EVENT_SIZE events, and a
+ * call on a full queue returns 0.
+ *
+ */
+#ifndef MBED_HOST_EVENTS_H
+#define MBED_HOST_EVENTS_H
+
+#include <stdint.h>
+#include <list>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "Callback.h"
+
+#define EVENTS_EVENT_SIZE 64
+#define EVENTS_QUEUE_SIZE (32 * EVENTS_EVENT_SIZE)
+
+namespace events {
+
+class EventQueue
+{
+public:
+    EventQueue(unsigned size = EVENTS_QUEUE_SIZE, unsigned char *buffer = NULL);
+
+    /** Run the events that are due, for ms milliseconds or until
+     *  break_dispatch(), -1 for ever
+     */
+    void dispatch(int ms = -1);
+    void dispatch_forever(void)
+    {
+        dispatch(-1);
+    }
+    void break_dispatch(void);
+
+    /** Cancel an event that did not run yet
+     *  @param id identifier returned by call or call_in
+     */
+    void cancel(int id);
+
+    template <typename F>
+    int call(F f)
+    {
+        return post(0, std::function<void()>(f));
+    }
+
+    template <typename T, typename R>
+    int call(T *obj, R (T::*method)(void))
+    {
+        return post(0, [obj, method]() {
+            (obj->*method)();
+        });
+    }
+
+    template <typename F>
+    int call_in(int ms, F f)
+    {
+        return post(ms, std::function<void()>(f));
+    }
+
+    template <typename T, typename R>
+    int call_in(int ms, T *obj, R (T::*method)(void))
+    {
+        return post(ms, [obj, method]() {
+            (obj->*method)();
+        });
+    }
+
+private:
+    struct event {
+        int id;
+        uint32_t due;
+        std::function<void()> func;
+    };
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::list<event> _events;
+    unsigned _capacity;
+    int _next_id;
+    bool _break;
+
+    int post(int ms, const std::function<void()> &func);
+};
+
+}
+
+using namespace events;
+
+#endif
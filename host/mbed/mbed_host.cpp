@@ -0,0 +1,225 @@
+/* Host build of the driver
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+#include <pthread.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "mbed.h"
+
+// Number of pins of the GPIO table
+#define HOST_GPIO_COUNT 256
+
+static int _gpio_level[HOST_GPIO_COUNT];
+static Callback<void(int)> _gpio_watch[HOST_GPIO_COUNT];
+static int _serial_fd[HOST_GPIO_COUNT];
+static std::vector<InterruptIn *> _gpio_irq;
+static std::recursive_mutex _critical;
+
+static bool gpio_valid(PinName pin)
+{
+    return (pin >= 0) && (pin < HOST_GPIO_COUNT);
+}
+
+extern "C" uint32_t us_ticker_read(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+
+/* The waits are the only points where a Thread can be terminated */
+extern "C" void wait_us(int us)
+{
+    if (rtos::Thread::sleep_us(us)) {
+        return;
+    }
+
+    struct timespec delay;
+    delay.tv_sec = us / 1000000;
+    delay.tv_nsec = (us % 1000000) * 1000;
+    nanosleep(&delay, NULL);
+}
+
+extern "C" void wait_ms(int ms)
+{
+    wait_us(ms * 1000);
+}
+
+extern "C" void wait(float s)
+{
+    wait_us((int)(s * 1000000));
+}
+
+extern "C" void core_util_critical_section_enter(void)
+{
+    _critical.lock();
+}
+
+extern "C" void core_util_critical_section_exit(void)
+{
+    _critical.unlock();
+}
+
+extern "C" void error(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    abort();
+}
+
+void host_gpio_set(PinName pin, int value)
+{
+    if (!gpio_valid(pin)) {
+        return;
+    }
+
+    int previous = _gpio_level[pin];
+    _gpio_level[pin] = value ? 1 : 0;
+    if (previous == _gpio_level[pin]) {
+        return;
+    }
+    for (size_t i = 0; i < _gpio_irq.size(); i++) {
+        if (_gpio_irq[i]->pin() == pin) {
+            _gpio_irq[i]->edge(_gpio_level[pin]);
+        }
+    }
+}
+
+int host_gpio_get(PinName pin)
+{
+    return gpio_valid(pin) ? _gpio_level[pin] : 0;
+}
+
+void host_gpio_attach(PinName pin, Callback<void(int)> func)
+{
+    if (gpio_valid(pin)) {
+        _gpio_watch[pin] = func;
+    }
+}
+
+void DigitalOut::write(int value)
+{
+    host_gpio_set(_pin, value);
+    if (gpio_valid(_pin) && _gpio_watch[_pin]) {
+        _gpio_watch[_pin](value ? 1 : 0);
+    }
+}
+
+InterruptIn::InterruptIn(PinName pin) : _pin(pin)
+{
+    _gpio_irq.push_back(this);
+}
+
+InterruptIn::~InterruptIn()
+{
+    for (size_t i = 0; i < _gpio_irq.size(); i++) {
+        if (_gpio_irq[i] == this) {
+            _gpio_irq.erase(_gpio_irq.begin() + i);
+            break;
+        }
+    }
+}
+
+void host_serial_attach(PinName tx, int fd)
+{
+    /* stored plus one, so that the table starts with no descriptor */
+    if (gpio_valid(tx)) {
+        _serial_fd[tx] = fd + 1;
+    }
+}
+
+RawSerial::RawSerial(PinName tx, PinName rx, int baud) : _fd(-1), _stop(false)
+{
+    if (!gpio_valid(tx) || (_serial_fd[tx] == 0)) {
+        return;
+    }
+    _fd = _serial_fd[tx] - 1;
+
+    /* Bytes go through unchanged, like on a UART */
+    struct termios tio;
+    if (tcgetattr(_fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(_fd, TCSANOW, &tio);
+    }
+    pthread_create(&_thread, NULL, rx_thread, this);
+}
+
+RawSerial::~RawSerial()
+{
+    if (_fd >= 0) {
+        _stop = true;
+        pthread_join(_thread, NULL);
+    }
+}
+
+/* Receive interrupts, while there is something to read */
+void *RawSerial::rx_thread(void *arg)
+{
+    RawSerial *serial = (RawSerial *)arg;
+
+    while (!serial->_stop) {
+        struct pollfd pfd = { serial->_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 10) <= 0) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(serial->_mutex);
+        if (serial->_irq[RxIrq] && (pfd.revents & POLLIN)) {
+            serial->_irq[RxIrq]();
+        } else {
+            /* left for getc(), or hung up */
+            poll(NULL, 0, 1);
+        }
+    }
+    return NULL;
+}
+
+int RawSerial::putc(int c)
+{
+    unsigned char byte = (unsigned char)c;
+    if ((_fd >= 0) && (write(_fd, &byte, 1) != 1)) {
+        return -1;
+    }
+    return c;
+}
+
+int RawSerial::getc(void)
+{
+    unsigned char byte;
+    if (!readable() || (read(_fd, &byte, 1) != 1)) {
+        return -1;
+    }
+    return byte;
+}
+
+int RawSerial::readable(void)
+{
+    if (_fd < 0) {
+        return 0;
+    }
+    struct pollfd pfd = { _fd, POLLIN, 0 };
+    return (poll(&pfd, 1, 0) > 0) && (pfd.revents & POLLIN);
+}
+
+void RawSerial::attach(Callback<void()> func, IrqType type)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _irq[type] = func;
+}
@@ -0,0 +1,447 @@
+/* Host build of the driver
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * Subset of the mbed OS network socket API used by the interface
+ *
+ * The stack, interface and socket classes follow the mbed OS 5 ones: a
+ * blocking socket call retries the stack call whenever the stack signals
+ * the socket, until the socket timeout. A send returns what the stack
+ * accepted, which may be less than requested.
+ *
+ */
+#ifndef MBED_HOST_NSAPI_H
+#define MBED_HOST_NSAPI_H
+
+#include <stdint.h>
+#include <string.h>
+#include "Callback.h"
+#include "rtos.h"
+
+typedef int nsapi_error_t;
+typedef unsigned int nsapi_size_t;
+typedef signed int nsapi_size_or_error_t;
+typedef void *nsapi_socket_t;
+
+enum nsapi_error {
+    NSAPI_ERROR_OK                  =  0,
+    NSAPI_ERROR_WOULD_BLOCK         = -3001,
+    NSAPI_ERROR_UNSUPPORTED         = -3002,
+    NSAPI_ERROR_PARAMETER           = -3003,
+    NSAPI_ERROR_NO_CONNECTION       = -3004,
+    NSAPI_ERROR_NO_SOCKET           = -3005,
+    NSAPI_ERROR_NO_ADDRESS          = -3006,
+    NSAPI_ERROR_NO_MEMORY           = -3007,
+    NSAPI_ERROR_NO_SSID             = -3008,
+    NSAPI_ERROR_DNS_FAILURE         = -3009,
+    NSAPI_ERROR_DHCP_FAILURE        = -3010,
+    NSAPI_ERROR_AUTH_FAILURE        = -3011,
+    NSAPI_ERROR_DEVICE_ERROR        = -3012,
+    NSAPI_ERROR_IN_PROGRESS         = -3013,
+    NSAPI_ERROR_ALREADY             = -3014,
+    NSAPI_ERROR_IS_CONNECTED        = -3015,
+    NSAPI_ERROR_CONNECTION_LOST     = -3016,
+    NSAPI_ERROR_CONNECTION_TIMEOUT  = -3017,
+    NSAPI_ERROR_ADDRESS_IN_USE      = -3018,
+    NSAPI_ERROR_TIMEOUT             = -3019,
+    NSAPI_ERROR_BUSY                = -3020,
+};
+
+typedef enum nsapi_connection_status {
+    NSAPI_STATUS_LOCAL_UP           = 0,
+    NSAPI_STATUS_GLOBAL_UP          = 1,
+    NSAPI_STATUS_DISCONNECTED       = 2,
+    NSAPI_STATUS_CONNECTING         = 3,
+    NSAPI_STATUS_ERROR_UNSUPPORTED  = NSAPI_ERROR_UNSUPPORTED
+} nsapi_connection_status_t;
+
+typedef enum nsapi_event {
+    NSAPI_EVENT_CONNECTION_STATUS_CHANGE = 0,
+} nsapi_event_t;
+
+typedef enum nsapi_security {
+    NSAPI_SECURITY_NONE         = 0x0,
+    NSAPI_SECURITY_WEP          = 0x1,
+    NSAPI_SECURITY_WPA          = 0x2,
+    NSAPI_SECURITY_WPA2         = 0x3,
+    NSAPI_SECURITY_WPA_WPA2     = 0x4,
+    NSAPI_SECURITY_PAP          = 0x5,
+    NSAPI_SECURITY_CHAP         = 0x6,
+    NSAPI_SECURITY_UNKNOWN      = 0xFF,
+} nsapi_security_t;
+
+typedef enum nsapi_version {
+    NSAPI_UNSPEC,
+    NSAPI_IPv4,
+    NSAPI_IPv6,
+} nsapi_version_t;
+
+typedef enum nsapi_protocol {
+    NSAPI_TCP,
+    NSAPI_UDP,
+} nsapi_protocol_t;
+
+typedef enum nsapi_socket_level {
+    NSAPI_STACK     = 5000,
+    NSAPI_SOCKET    = 7000,
+} nsapi_socket_level_t;
+
+typedef enum nsapi_socket_option {
+    NSAPI_REUSEADDR,
+    NSAPI_KEEPALIVE,
+    NSAPI_KEEPIDLE,
+    NSAPI_KEEPINTVL,
+    NSAPI_LINGER,
+    NSAPI_SNDBUF,
+    NSAPI_RCVBUF,
+} nsapi_socket_option_t;
+
+#define NSAPI_IP_SIZE 46
+#define NSAPI_IPv4_SIZE 16
+#define NSAPI_MAC_SIZE 18
+
+typedef struct nsapi_wifi_ap {
+    char ssid[33];
+    uint8_t bssid[6];
+    nsapi_security_t security;
+    int8_t rssi;
+    uint8_t channel;
+} nsapi_wifi_ap_t;
+
+class WiFiAccessPoint
+{
+public:
+    WiFiAccessPoint()
+    {
+        memset(&_ap, 0, sizeof(_ap));
+    }
+    WiFiAccessPoint(nsapi_wifi_ap_t ap) : _ap(ap) {}
+    const char *get_ssid() const
+    {
+        return _ap.ssid;
+    }
+    const uint8_t *get_bssid() const
+    {
+        return _ap.bssid;
+    }
+    nsapi_security_t get_security() const
+    {
+        return _ap.security;
+    }
+    int8_t get_rssi() const
+    {
+        return _ap.rssi;
+    }
+    uint8_t get_channel() const
+    {
+        return _ap.channel;
+    }
+
+private:
+    nsapi_wifi_ap_t _ap;
+};
+
+/** IPv4 address and port, held as text and bytes
+ */
+class SocketAddress
+{
+public:
+    SocketAddress(const char *addr = NULL, uint16_t port = 0);
+    bool set_ip_address(const char *addr);
+    void set_port(uint16_t port)
+    {
+        _port = port;
+    }
+    const char *get_ip_address() const
+    {
+        return _version == NSAPI_UNSPEC ? NULL : _ip;
+    }
+    const void *get_ip_bytes() const
+    {
+        return _bytes;
+    }
+    uint16_t get_port() const
+    {
+        return _port;
+    }
+    nsapi_version_t get_ip_version() const
+    {
+        return _version;
+    }
+    operator bool() const;
+
+    friend bool operator==(const SocketAddress &a, const SocketAddress &b);
+    friend bool operator!=(const SocketAddress &a, const SocketAddress &b);
+
+private:
+    char _ip[NSAPI_IP_SIZE];
+    uint8_t _bytes[4];
+    nsapi_version_t _version;
+    uint16_t _port;
+};
+
+class NetworkStack;
+class Socket;
+class TCPSocket;
+class UDPSocket;
+class TCPServer;
+
+class NetworkInterface
+{
+public:
+    virtual ~NetworkInterface() {}
+    virtual const char *get_mac_address()
+    {
+        return NULL;
+    }
+    virtual const char *get_ip_address() = 0;
+    virtual const char *get_netmask()
+    {
+        return NULL;
+    }
+    virtual const char *get_gateway()
+    {
+        return NULL;
+    }
+    virtual nsapi_error_t connect() = 0;
+    virtual nsapi_error_t disconnect() = 0;
+    virtual nsapi_error_t gethostbyname(const char *host, SocketAddress *address,
+                                        nsapi_version_t version = NSAPI_UNSPEC);
+    virtual nsapi_error_t add_dns_server(const SocketAddress &address)
+    {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+    virtual void attach(mbed::Callback<void(nsapi_event_t, intptr_t)> status_cb) {}
+    virtual nsapi_connection_status_t get_connection_status() const
+    {
+        return NSAPI_STATUS_ERROR_UNSUPPORTED;
+    }
+    virtual nsapi_error_t set_blocking(bool blocking)
+    {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+
+protected:
+    friend NetworkStack *nsapi_create_stack(NetworkInterface *iface);
+    virtual NetworkStack *get_stack() = 0;
+};
+
+class WiFiInterface : public NetworkInterface
+{
+public:
+    virtual nsapi_error_t set_credentials(const char *ssid, const char *pass,
+                                          nsapi_security_t security = NSAPI_SECURITY_NONE) = 0;
+    virtual nsapi_error_t set_channel(uint8_t channel) = 0;
+    virtual int8_t get_rssi() = 0;
+    virtual nsapi_error_t connect(const char *ssid, const char *pass,
+                                  nsapi_security_t security = NSAPI_SECURITY_NONE, uint8_t channel = 0) = 0;
+    virtual nsapi_error_t connect() = 0;
+    virtual nsapi_error_t disconnect() = 0;
+    virtual nsapi_size_or_error_t scan(WiFiAccessPoint *res, nsapi_size_t count) = 0;
+};
+
+class NetworkStack
+{
+public:
+    virtual ~NetworkStack() {}
+    virtual const char *get_ip_address() = 0;
+
+    /** Resolves IP address literals only, stacks resolve names themselves
+     */
+    virtual nsapi_error_t gethostbyname(const char *host, SocketAddress *address,
+                                        nsapi_version_t version = NSAPI_UNSPEC);
+    virtual nsapi_error_t add_dns_server(const SocketAddress &address)
+    {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+    virtual nsapi_error_t setstackopt(int level, int optname, const void *optval, unsigned optlen)
+    {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+    virtual nsapi_error_t getstackopt(int level, int optname, void *optval, unsigned *optlen)
+    {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+
+protected:
+    friend class Socket;
+    friend class TCPSocket;
+    friend class UDPSocket;
+    friend class TCPServer;
+
+    virtual nsapi_error_t socket_open(nsapi_socket_t *handle, nsapi_protocol_t proto) = 0;
+    virtual nsapi_error_t socket_close(nsapi_socket_t handle) = 0;
+    virtual nsapi_error_t socket_bind(nsapi_socket_t handle, const SocketAddress &address) = 0;
+    virtual nsapi_error_t socket_listen(nsapi_socket_t handle, int backlog) = 0;
+    virtual nsapi_error_t socket_connect(nsapi_socket_t handle, const SocketAddress &address) = 0;
+    virtual nsapi_error_t socket_accept(nsapi_socket_t server, nsapi_socket_t *handle,
+                                        SocketAddress *address = 0) = 0;
+    virtual nsapi_size_or_error_t socket_send(nsapi_socket_t handle, const void *data, nsapi_size_t size) = 0;
+    virtual nsapi_size_or_error_t socket_recv(nsapi_socket_t handle, void *data, nsapi_size_t size) = 0;
+    virtual nsapi_size_or_error_t socket_sendto(nsapi_socket_t handle, const SocketAddress &address,
+                                                const void *data, nsapi_size_t size) = 0;
+    virtual nsapi_size_or_error_t socket_recvfrom(nsapi_socket_t handle, SocketAddress *address,
+                                                  void *buffer, nsapi_size_t size) = 0;
+    virtual void socket_attach(nsapi_socket_t handle, void (*callback)(void *), void *data) = 0;
+    virtual nsapi_error_t setsockopt(nsapi_socket_t handle, int level, int optname,
+                                     const void *optval, unsigned optlen)
+    {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+    virtual nsapi_error_t getsockopt(nsapi_socket_t handle, int level, int optname,
+                                     void *optval, unsigned *optlen)
+    {
+        return NSAPI_ERROR_UNSUPPORTED;
+    }
+};
+
+inline NetworkStack *nsapi_create_stack(NetworkStack *stack)
+{
+    return stack;
+}
+
+NetworkStack *nsapi_create_stack(NetworkInterface *iface);
+
+/* The stack of a class which is both an interface and a stack, like
+ * ISM43362Interface, is the one of the interface */
+template <typename IF>
+NetworkStack *nsapi_create_stack(IF *iface)
+{
+    return nsapi_create_stack(static_cast<NetworkInterface *>(iface));
+}
+
+class Socket
+{
+public:
+    virtual ~Socket();
+
+    template <typename S>
+    nsapi_error_t open(S *stack)
+    {
+        return open(nsapi_create_stack(stack));
+    }
+    nsapi_error_t open(NetworkStack *stack);
+    nsapi_error_t close(void);
+    nsapi_error_t bind(uint16_t port);
+    nsapi_error_t bind(const SocketAddress &address);
+    void set_blocking(bool blocking)
+    {
+        set_timeout(blocking ? -1 : 0);
+    }
+    void set_timeout(int timeout)
+    {
+        _timeout = (timeout >= 0) ? (uint32_t)timeout : osWaitForever;
+    }
+    nsapi_error_t setsockopt(int level, int optname, const void *optval, unsigned optlen);
+    nsapi_error_t getsockopt(int level, int optname, void *optval, unsigned *optlen);
+
+    /** Function called from the stack whenever the socket state changes
+     */
+    void sigio(mbed::Callback<void()> func);
+
+protected:
+    Socket();
+    virtual nsapi_protocol_t get_proto() = 0;
+
+    /** Wait for the stack to signal the socket
+     *  @return false once the socket timeout expired
+     */
+    bool wait_event(uint32_t start);
+
+    NetworkStack *_stack;
+    nsapi_socket_t _socket;
+    uint32_t _timeout;
+    rtos::Mutex _lock;
+    rtos::EventFlags _event;
+    mbed::Callback<void()> _callback;
+
+    /** Callback attached to the stack socket
+     */
+    static void event(void *socket);
+};
+
+class TCPSocket : public Socket
+{
+public:
+    TCPSocket() {}
+    template <typename S>
+    TCPSocket(S *stack)
+    {
+        open(stack);
+    }
+    virtual ~TCPSocket()
+    {
+        close();
+    }
+    nsapi_error_t connect(const char *host, uint16_t port);
+    nsapi_error_t connect(const SocketAddress &address);
+    nsapi_size_or_error_t send(const void *data, nsapi_size_t size);
+    nsapi_size_or_error_t recv(void *data, nsapi_size_t size);
+
+protected:
+    friend class TCPServer;
+    virtual nsapi_protocol_t get_proto()
+    {
+        return NSAPI_TCP;
+    }
+};
+
+class UDPSocket : public Socket
+{
+public:
+    UDPSocket() {}
+    template <typename S>
+    UDPSocket(S *stack)
+    {
+        open(stack);
+    }
+    virtual ~UDPSocket()
+    {
+        close();
+    }
+    nsapi_size_or_error_t sendto(const char *host, uint16_t port, const void *data, nsapi_size_t size);
+    nsapi_size_or_error_t sendto(const SocketAddress &address, const void *data, nsapi_size_t size);
+    nsapi_size_or_error_t recvfrom(SocketAddress *address, void *data, nsapi_size_t size);
+
+protected:
+    virtual nsapi_protocol_t get_proto()
+    {
+        return NSAPI_UDP;
+    }
+};
+
+class TCPServer : public Socket
+{
+public:
+    TCPServer() {}
+    virtual ~TCPServer()
+    {
+        close();
+    }
+    nsapi_error_t listen(int backlog = 1);
+
+    /** Accept a connection, the connection socket must not be open
+     */
+    nsapi_error_t accept(TCPSocket *connection, SocketAddress *address = NULL);
+
+protected:
+    virtual nsapi_protocol_t get_proto()
+    {
+        return NSAPI_TCP;
+    }
+};
+
+#endif
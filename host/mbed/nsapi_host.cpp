@@ -0,0 +1,359 @@
+/* Host build of the driver
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arpa/inet.h>
+#include "mbed.h"
+
+// Events signaled by the stack to a socket
+#define SOCKET_EVENT 0x1
+
+/* SocketAddress */
+
+SocketAddress::SocketAddress(const char *addr, uint16_t port)
+    : _version(NSAPI_UNSPEC), _port(port)
+{
+    memset(_ip, 0, sizeof(_ip));
+    memset(_bytes, 0, sizeof(_bytes));
+    if (addr) {
+        set_ip_address(addr);
+    }
+}
+
+bool SocketAddress::set_ip_address(const char *addr)
+{
+    if ((addr == NULL) || (inet_pton(AF_INET, addr, _bytes) != 1)) {
+        _version = NSAPI_UNSPEC;
+        memset(_ip, 0, sizeof(_ip));
+        memset(_bytes, 0, sizeof(_bytes));
+        return false;
+    }
+    inet_ntop(AF_INET, _bytes, _ip, sizeof(_ip));
+    _version = NSAPI_IPv4;
+    return true;
+}
+
+SocketAddress::operator bool() const
+{
+    if (_version == NSAPI_UNSPEC) {
+        return false;
+    }
+    for (unsigned i = 0; i < sizeof(_bytes); i++) {
+        if (_bytes[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool operator==(const SocketAddress &a, const SocketAddress &b)
+{
+    if (!a && !b) {
+        return true;
+    }
+    return (a._version == b._version) && (memcmp(a._bytes, b._bytes, sizeof(a._bytes)) == 0)
+           && (a._port == b._port);
+}
+
+bool operator!=(const SocketAddress &a, const SocketAddress &b)
+{
+    return !(a == b);
+}
+
+/* Stack and interface */
+
+nsapi_error_t NetworkStack::gethostbyname(const char *host, SocketAddress *address, nsapi_version_t version)
+{
+    if (address->set_ip_address(host)) {
+        return NSAPI_ERROR_OK;
+    }
+    return NSAPI_ERROR_UNSUPPORTED;
+}
+
+nsapi_error_t NetworkInterface::gethostbyname(const char *host, SocketAddress *address, nsapi_version_t version)
+{
+    return get_stack()->gethostbyname(host, address, version);
+}
+
+NetworkStack *nsapi_create_stack(NetworkInterface *iface)
+{
+    return iface->get_stack();
+}
+
+/* Socket */
+
+Socket::Socket() : _stack(NULL), _socket(NULL), _timeout(osWaitForever)
+{
+}
+
+Socket::~Socket()
+{
+}
+
+void Socket::event(void *socket)
+{
+    Socket *s = (Socket *)socket;
+    s->_event.set(SOCKET_EVENT);
+    if (s->_callback) {
+        s->_callback();
+    }
+}
+
+nsapi_error_t Socket::open(NetworkStack *stack)
+{
+    _lock.lock();
+    if (_stack != NULL || stack == NULL) {
+        _lock.unlock();
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    nsapi_socket_t socket;
+    nsapi_error_t err = stack->socket_open(&socket, get_proto());
+    if (err == NSAPI_ERROR_OK) {
+        _stack = stack;
+        _socket = socket;
+        _stack->socket_attach(_socket, event, this);
+    }
+    _lock.unlock();
+    return err;
+}
+
+nsapi_error_t Socket::close(void)
+{
+    _lock.lock();
+    nsapi_error_t err = NSAPI_ERROR_OK;
+    if (_socket) {
+        /* Detached first, so that no event runs on a closed socket */
+        _stack->socket_attach(_socket, 0, 0);
+        nsapi_socket_t socket = _socket;
+        _socket = NULL;
+        err = _stack->socket_close(socket);
+    }
+    _stack = NULL;
+    _event.set(SOCKET_EVENT);
+    _lock.unlock();
+    return err;
+}
+
+nsapi_error_t Socket::bind(uint16_t port)
+{
+    return bind(SocketAddress(NULL, port));
+}
+
+nsapi_error_t Socket::bind(const SocketAddress &address)
+{
+    _lock.lock();
+    nsapi_error_t err = _socket ? _stack->socket_bind(_socket, address) : NSAPI_ERROR_NO_SOCKET;
+    _lock.unlock();
+    return err;
+}
+
+nsapi_error_t Socket::setsockopt(int level, int optname, const void *optval, unsigned optlen)
+{
+    _lock.lock();
+    nsapi_error_t err = _socket ? _stack->setsockopt(_socket, level, optname, optval, optlen) : NSAPI_ERROR_NO_SOCKET;
+    _lock.unlock();
+    return err;
+}
+
+nsapi_error_t Socket::getsockopt(int level, int optname, void *optval, unsigned *optlen)
+{
+    _lock.lock();
+    nsapi_error_t err = _socket ? _stack->getsockopt(_socket, level, optname, optval, optlen) : NSAPI_ERROR_NO_SOCKET;
+    _lock.unlock();
+    return err;
+}
+
+void Socket::sigio(mbed::Callback<void()> func)
+{
+    _lock.lock();
+    _callback = func;
+    _lock.unlock();
+}
+
+bool Socket::wait_event(uint32_t start)
+{
+    if (_timeout == 0) {
+        return false;
+    }
+    if (_timeout == osWaitForever) {
+        _event.wait_any(SOCKET_EVENT);
+        return true;
+    }
+    uint32_t elapsed = (us_ticker_read() - start) / 1000;
+    if (elapsed >= _timeout) {
+        return false;
+    }
+    _event.wait_any(SOCKET_EVENT, _timeout - elapsed);
+    return true;
+}
+
+/* TCPSocket */
+
+nsapi_error_t TCPSocket::connect(const char *host, uint16_t port)
+{
+    SocketAddress address;
+    nsapi_error_t err = _stack ? _stack->gethostbyname(host, &address) : NSAPI_ERROR_NO_SOCKET;
+    if (err) {
+        return err;
+    }
+    address.set_port(port);
+    return connect(address);
+}
+
+nsapi_error_t TCPSocket::connect(const SocketAddress &address)
+{
+    _lock.lock();
+    nsapi_error_t err = _socket ? _stack->socket_connect(_socket, address) : NSAPI_ERROR_NO_SOCKET;
+    _lock.unlock();
+    return err;
+}
+
+nsapi_size_or_error_t TCPSocket::send(const void *data, nsapi_size_t size)
+{
+    uint32_t start = us_ticker_read();
+    nsapi_size_or_error_t ret;
+
+    _lock.lock();
+    while (true) {
+        if (!_socket) {
+            ret = NSAPI_ERROR_NO_SOCKET;
+            break;
+        }
+        _event.clear(SOCKET_EVENT);
+        ret = _stack->socket_send(_socket, data, size);
+        if ((ret != NSAPI_ERROR_WOULD_BLOCK) || !wait_event(start)) {
+            break;
+        }
+    }
+    _lock.unlock();
+    return ret;
+}
+
+nsapi_size_or_error_t TCPSocket::recv(void *data, nsapi_size_t size)
+{
+    uint32_t start = us_ticker_read();
+    nsapi_size_or_error_t ret;
+
+    _lock.lock();
+    while (true) {
+        if (!_socket) {
+            ret = NSAPI_ERROR_NO_SOCKET;
+            break;
+        }
+        _event.clear(SOCKET_EVENT);
+        ret = _stack->socket_recv(_socket, data, size);
+        if ((ret != NSAPI_ERROR_WOULD_BLOCK) || !wait_event(start)) {
+            break;
+        }
+    }
+    _lock.unlock();
+    return ret;
+}
+
+/* UDPSocket */
+
+nsapi_size_or_error_t UDPSocket::sendto(const char *host, uint16_t port, const void *data, nsapi_size_t size)
+{
+    SocketAddress address;
+    nsapi_error_t err = _stack ? _stack->gethostbyname(host, &address) : NSAPI_ERROR_NO_SOCKET;
+    if (err) {
+        return err;
+    }
+    address.set_port(port);
+    return sendto(address, data, size);
+}
+
+nsapi_size_or_error_t UDPSocket::sendto(const SocketAddress &address, const void *data, nsapi_size_t size)
+{
+    uint32_t start = us_ticker_read();
+    nsapi_size_or_error_t ret;
+
+    _lock.lock();
+    while (true) {
+        if (!_socket) {
+            ret = NSAPI_ERROR_NO_SOCKET;
+            break;
+        }
+        _event.clear(SOCKET_EVENT);
+        ret = _stack->socket_sendto(_socket, address, data, size);
+        if ((ret != NSAPI_ERROR_WOULD_BLOCK) || !wait_event(start)) {
+            break;
+        }
+    }
+    _lock.unlock();
+    return ret;
+}
+
+nsapi_size_or_error_t UDPSocket::recvfrom(SocketAddress *address, void *data, nsapi_size_t size)
+{
+    uint32_t start = us_ticker_read();
+    nsapi_size_or_error_t ret;
+
+    _lock.lock();
+    while (true) {
+        if (!_socket) {
+            ret = NSAPI_ERROR_NO_SOCKET;
+            break;
+        }
+        _event.clear(SOCKET_EVENT);
+        ret = _stack->socket_recvfrom(_socket, address, data, size);
+        if ((ret != NSAPI_ERROR_WOULD_BLOCK) || !wait_event(start)) {
+            break;
+        }
+    }
+    _lock.unlock();
+    return ret;
+}
+
+/* TCPServer */
+
+nsapi_error_t TCPServer::listen(int backlog)
+{
+    _lock.lock();
+    nsapi_error_t err = _socket ? _stack->socket_listen(_socket, backlog) : NSAPI_ERROR_NO_SOCKET;
+    _lock.unlock();
+    return err;
+}
+
+nsapi_error_t TCPServer::accept(TCPSocket *connection, SocketAddress *address)
+{
+    uint32_t start = us_ticker_read();
+    nsapi_error_t ret;
+
+    _lock.lock();
+    while (true) {
+        if (!_socket) {
+            ret = NSAPI_ERROR_NO_SOCKET;
+            break;
+        }
+        _event.clear(SOCKET_EVENT);
+        nsapi_socket_t socket;
+        ret = _stack->socket_accept(_socket, &socket, address);
+        if (ret == NSAPI_ERROR_OK) {
+            connection->_lock.lock();
+            connection->_stack = _stack;
+            connection->_socket = socket;
+            _stack->socket_attach(socket, event, connection);
+            connection->_lock.unlock();
+            break;
+        }
+        if ((ret != NSAPI_ERROR_WOULD_BLOCK) || !wait_event(start)) {
+            break;
+        }
+    }
+    _lock.unlock();
+    return ret;
+}
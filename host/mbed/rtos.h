@@ -0,0 +1,185 @@
+/* Host build of the driver
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * Subset of the mbed OS RTOS API on top of POSIX threads
+ *
+ * A Thread is a pthread which can only be terminated while it sleeps in
+ * wait_us(), wait_ms() or wait(), like the socket read thread of the
+ * interface does between its polls: the wait then unwinds the thread.
+ * Destroying a Thread terminates it.
+ *
+ */
+#ifndef MBED_HOST_RTOS_H
+#define MBED_HOST_RTOS_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <mutex>
+#include <condition_variable>
+#include "Callback.h"
+
+#define osWaitForever 0xFFFFFFFFU
+#define osFlagsError 0x80000000U
+#define osFlagsErrorTimeout 0xFFFFFFFEU
+
+typedef int32_t osStatus;
+#define osOK 0
+#define osErrorResource (-3)
+
+typedef enum {
+    osPriorityLow = 8,
+    osPriorityBelowNormal = 16,
+    osPriorityNormal = 24,
+    osPriorityAboveNormal = 32,
+    osPriorityHigh = 40,
+    osPriorityRealtime = 48,
+} osPriority;
+
+typedef void *osThreadId;
+osThreadId osThreadGetId(void);
+
+#ifndef OS_STACK_SIZE
+#define OS_STACK_SIZE 4096
+#endif
+
+namespace rtos {
+
+/** Recursive mutex, like the RTX one
+ */
+class Mutex
+{
+public:
+    int lock(uint32_t millisec = osWaitForever)
+    {
+        _mutex.lock();
+        return 0;
+    }
+    bool trylock(void)
+    {
+        return _mutex.try_lock();
+    }
+    int unlock(void)
+    {
+        _mutex.unlock();
+        return 0;
+    }
+
+private:
+    std::recursive_mutex _mutex;
+};
+
+/** Counting semaphore
+ */
+class Semaphore
+{
+public:
+    Semaphore(int32_t count = 0) : _count(count) {}
+
+    /** Wait for a token
+     *  @return number of tokens available before taking one, 0 on timeout
+     */
+    int32_t wait(uint32_t millisec = osWaitForever);
+    osStatus release(void);
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    int32_t _count;
+};
+
+/** Group of 31 event flags
+ */
+class EventFlags
+{
+public:
+    EventFlags() : _flags(0) {}
+    uint32_t set(uint32_t flags);
+    uint32_t clear(uint32_t flags = 0x7fffffff);
+    uint32_t get(void) const;
+
+    /** Wait for any of the flags
+     *  @return flags set when the wait ended, osFlagsErrorTimeout on timeout
+     */
+    uint32_t wait_any(uint32_t flags = 0, uint32_t millisec = osWaitForever, bool clear = true);
+
+    /** Wait for all the flags
+     *  @return flags set when the wait ended, osFlagsErrorTimeout on timeout
+     */
+    uint32_t wait_all(uint32_t flags = 0, uint32_t millisec = osWaitForever, bool clear = true);
+
+private:
+    mutable std::mutex _mutex;
+    std::condition_variable _cond;
+    uint32_t _flags;
+
+    uint32_t wait(uint32_t flags, uint32_t millisec, bool clear, bool all);
+};
+
+class Thread
+{
+public:
+    Thread(osPriority priority = osPriorityNormal, uint32_t stack_size = OS_STACK_SIZE,
+           unsigned char *stack_mem = NULL, const char *name = NULL)
+        : _started(false), _terminate(false) {}
+
+    /** Terminates the thread if it is still running
+     */
+    virtual ~Thread();
+
+    osStatus start(mbed::Callback<void()> task);
+
+    /** Wait for the thread to return
+     */
+    osStatus join(void);
+
+    /** Stop the thread at its next wait, then wait for it
+     */
+    osStatus terminate(void);
+
+    osThreadId get_id(void) const
+    {
+        return _started ? (osThreadId)_thread : NULL;
+    }
+
+    /** Sleep of the calling thread, if it is a Thread, for wait_us()
+     *  @return false if the calling thread is not a Thread
+     */
+    static bool sleep_us(uint32_t us);
+
+private:
+    struct terminated {};
+
+    pthread_t _thread;
+    mbed::Callback<void()> _task;
+    bool _started;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    bool _terminate;
+
+    static void *entry(void *thread);
+};
+
+namespace ThisThread {
+void sleep_for(uint32_t millisec);
+osThreadId get_id(void);
+}
+
+}
+
+using namespace rtos;
+
+#endif
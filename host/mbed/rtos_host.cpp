@@ -0,0 +1,265 @@
+/* Host build of the driver
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include "mbed.h"
+
+osThreadId osThreadGetId(void)
+{
+    return (osThreadId)pthread_self();
+}
+
+/* Semaphore */
+
+int32_t Semaphore::wait(uint32_t millisec)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (millisec == osWaitForever) {
+        _cond.wait(lock, [this]() { return _count > 0; });
+    } else if (!_cond.wait_for(lock, std::chrono::milliseconds(millisec), [this]() { return _count > 0; })) {
+        return 0;
+    }
+    return _count--;
+}
+
+osStatus Semaphore::release(void)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _count++;
+    _cond.notify_one();
+    return osOK;
+}
+
+/* EventFlags */
+
+uint32_t EventFlags::set(uint32_t flags)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _flags |= flags;
+    _cond.notify_all();
+    return _flags;
+}
+
+uint32_t EventFlags::clear(uint32_t flags)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t previous = _flags;
+    _flags &= ~flags;
+    return previous;
+}
+
+uint32_t EventFlags::get(void) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _flags;
+}
+
+uint32_t EventFlags::wait_any(uint32_t flags, uint32_t millisec, bool clear)
+{
+    return wait(flags, millisec, clear, false);
+}
+
+uint32_t EventFlags::wait_all(uint32_t flags, uint32_t millisec, bool clear)
+{
+    return wait(flags, millisec, clear, true);
+}
+
+uint32_t EventFlags::wait(uint32_t flags, uint32_t millisec, bool clear, bool all)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto ready = [this, flags, all]() {
+        return all ? ((_flags & flags) == flags) : ((_flags & flags) != 0);
+    };
+
+    if (millisec == osWaitForever) {
+        _cond.wait(lock, ready);
+    } else if (!_cond.wait_for(lock, std::chrono::milliseconds(millisec), ready)) {
+        return osFlagsErrorTimeout;
+    }
+
+    uint32_t result = _flags;
+    if (clear) {
+        _flags &= ~flags;
+    }
+    return result;
+}
+
+/* Thread */
+
+static thread_local Thread *current_thread;
+
+Thread::~Thread()
+{
+    terminate();
+}
+
+void *Thread::entry(void *arg)
+{
+    Thread *thread = (Thread *)arg;
+
+    current_thread = thread;
+    try {
+        thread->_task();
+    } catch (const terminated &) {
+        /* unwound from a wait by terminate() */
+    }
+    return NULL;
+}
+
+bool Thread::sleep_us(uint32_t us)
+{
+    Thread *thread = current_thread;
+    if (thread == NULL) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(thread->_mutex);
+    thread->_cond.wait_for(lock, std::chrono::microseconds(us), [thread]() {
+        return thread->_terminate;
+    });
+    if (thread->_terminate) {
+        throw terminated();
+    }
+    return true;
+}
+
+osStatus Thread::start(mbed::Callback<void()> task)
+{
+    if (_started) {
+        return osErrorResource;
+    }
+    _task = task;
+    if (pthread_create(&_thread, NULL, entry, this) != 0) {
+        return osErrorResource;
+    }
+    _started = true;
+    return osOK;
+}
+
+osStatus Thread::join(void)
+{
+    if (!_started) {
+        return osErrorResource;
+    }
+    pthread_join(_thread, NULL);
+    _started = false;
+    return osOK;
+}
+
+osStatus Thread::terminate(void)
+{
+    if (!_started) {
+        return osErrorResource;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _terminate = true;
+        _cond.notify_all();
+    }
+    return join();
+}
+
+void ThisThread::sleep_for(uint32_t millisec)
+{
+    wait_ms(millisec);
+}
+
+osThreadId ThisThread::get_id(void)
+{
+    return osThreadGetId();
+}
+
+/* EventQueue */
+
+EventQueue::EventQueue(unsigned size, unsigned char *buffer)
+    : _capacity(size / EVENTS_EVENT_SIZE), _next_id(1), _break(false)
+{
+}
+
+int EventQueue::post(int ms, const std::function<void()> &func)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (_events.size() >= _capacity) {
+        return 0;
+    }
+
+    event e;
+    e.id = _next_id++;
+    e.due = us_ticker_read() / 1000 + ms;
+    e.func = func;
+
+    /* Ordered by due time, then by posting order */
+    std::list<event>::iterator it = _events.begin();
+    while ((it != _events.end()) && ((int32_t)(it->due - e.due) <= 0)) {
+        ++it;
+    }
+    _events.insert(it, e);
+    _cond.notify_all();
+    return e.id;
+}
+
+void EventQueue::cancel(int id)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (std::list<event>::iterator it = _events.begin(); it != _events.end(); ++it) {
+        if (it->id == id) {
+            _events.erase(it);
+            break;
+        }
+    }
+}
+
+void EventQueue::break_dispatch(void)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _break = true;
+    _cond.notify_all();
+}
+
+void EventQueue::dispatch(int ms)
+{
+    uint32_t end = us_ticker_read() / 1000 + ms;
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    while (!_break) {
+        uint32_t now = us_ticker_read() / 1000;
+        if (!_events.empty() && ((int32_t)(_events.front().due - now) <= 0)) {
+            /* Events run without the queue lock, so that they can post */
+            std::function<void()> func = _events.front().func;
+            _events.pop_front();
+            lock.unlock();
+            func();
+            lock.lock();
+            continue;
+        }
+
+        if ((ms >= 0) && ((int32_t)(end - now) <= 0)) {
+            break;
+        }
+        uint32_t wait = 1000;
+        if (!_events.empty()) {
+            wait = _events.front().due - now;
+        }
+        if (ms >= 0) {
+            wait = std::min(wait, end - now);
+        }
+        _cond.wait_for(lock, std::chrono::milliseconds(wait));
+    }
+    _break = false;
+}
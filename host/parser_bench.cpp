@@ -0,0 +1,200 @@
+/* Microbenchmark of the module response parsing
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <time.h>
+#include <functional>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "ISM43362.h"
+#include "FrameTransport.h"
+#include "ResponseFrames.h"
+
+// Minimum duration of each benchmark
+#define BENCH_MIN_TIME 200 /* milliseconds */
+
+extern "C" int32_t ParseNumber(char *ptr, uint8_t *cnt);
+extern "C" uint32_t ParseHexNumber(char *ptr, uint8_t *cnt);
+extern "C" nsapi_security_t ParseSecurity(char *ptr);
+
+/* Cycle counter where available, nanoseconds otherwise */
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+static uint64_t nanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static volatile int sink;
+
+static const std::string &frame_of(const std::vector<response_frame_t> &frames, const char *name)
+{
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (strcmp(frames[i].name, name) == 0) {
+            return frames[i].frame;
+        }
+    }
+    fprintf(stderr, "no %s frame\n", name);
+    exit(2);
+}
+
+/* Runs op until BENCH_MIN_TIME elapsed, then prints the cost per response */
+static void bench(const char *name, uint32_t bytes, const std::function<bool()> &op)
+{
+    uint64_t start_ns = nanoseconds();
+    uint64_t start = cycles();
+    uint64_t ops = 0;
+    uint64_t failures = 0;
+
+    do {
+        for (int i = 0; i < 64; i++) {
+            failures += op() ? 0 : 1;
+        }
+        ops += 64;
+    } while ((nanoseconds() - start_ns) < (uint64_t)BENCH_MIN_TIME * 1000000);
+
+    double total = (double)(cycles() - start);
+    double ns = (double)(nanoseconds() - start_ns);
+    printf("%-14s %10llu %10.1f %12.1f %8lu %10.2f%s\r\n", name, (unsigned long long)ops,
+           ns / ops, total / ops, (unsigned long)bytes, bytes ? total / ops / bytes : 0.0,
+           failures ? "  (failed)" : "");
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<response_frame_t> frames = response_frames();
+    std::vector<response_frame_t> recorded;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:h")) != -1) {
+        switch (opt) {
+            case 'r':
+                if (response_frames_load(optarg, recorded) < 0) {
+                    perror(optarg);
+                    return 2;
+                }
+                break;
+            default:
+                printf("Usage: %s [-r recording]\r\n", argv[0]);
+                printf("  Measures the parsing of typical responses, and of the Rx frames of a\r\n");
+                printf("  SpiRecorder dump\r\n");
+                return 2;
+        }
+    }
+
+    FrameTransport *link = new FrameTransport();
+    ISM43362 wifi(link, NC, NC);
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (strcmp(frames[i].name, "recv_empty") != 0) {
+            link->set_response(frames[i].prefix, frames[i].frame);
+        }
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    printf("%-14s %10s %10s %12s %8s %10s\r\n", "response", "count", "ns/op", "cycles/op", "bytes", "cycles/B");
+#else
+    printf("%-14s %10s %10s %12s %8s %10s\r\n", "response", "count", "ns/op", "ns/op", "bytes", "ns/B");
+#endif
+
+    /* Driver calls, each one sending a command and parsing its response */
+    static char data[ES_WIFI_RX_BUFFER_SIZE];
+    static WiFiAccessPoint ap[16];
+    char ip[NSAPI_IP_SIZE];
+    int port;
+    for (size_t i = 0; i < frames.size(); i++) {
+        const response_frame_t &f = frames[i];
+        uint32_t bytes = f.frame.size();
+        std::string name(f.name);
+
+        if (name == "status") {
+            bench("status", bytes, [&]() { return wifi.getIPAddress() != NULL; });
+        } else if (name == "rssi") {
+            bench("rssi", bytes, [&]() { int8_t rssi; return wifi.getRSSI(rssi); });
+        } else if (name == "version") {
+            bench("version", bytes, [&]() { return wifi.get_firmware_version() != NULL; });
+        } else if (name == "mac") {
+            bench("mac", bytes, [&]() { return wifi.getMACAddress() != NULL; });
+        } else if (name == "scan") {
+            bench("scan", bytes, [&]() { return wifi.scan(ap, 16) > 0; });
+        } else if (name == "recv") {
+            bench("recv", bytes, [&]() { return wifi.check_recv_status(0, data) > 0; });
+        } else if (name == "recv_empty") {
+            link->set_response("R0", f.frame);
+            bench("recv_empty", bytes, [&]() { return wifi.check_recv_status(0, data) == 0; });
+            link->set_response("R0", frame_of(frames, "recv"));
+        } else if (name == "socket") {
+            bench("socket", bytes, [&]() { return wifi.socket_status(0) >= 0; });
+        } else if (name == "accept") {
+            bench("accept", bytes, [&]() { return wifi.accept(0, ip, &port) == 1; });
+        } else if (name == "dns") {
+            bench("dns", bytes, [&]() { return wifi.dns_lookup("example.com", ip); });
+        } else if (name == "error") {
+            bench("error", bytes, [&]() { return !wifi.close(0); });
+        }
+    }
+
+    /* Parser primitives, consuming the whole response like check_response() */
+    ATParser parser(*link);
+    link->set_response("XX", "12,-34,abcdef\r\nOK\r\n> ");
+    bench("vrecv", 22, [&]() {
+        int a, b;
+        char s[8];
+        return parser.send("XX") && parser.recv("%d,%d,%7s\r\n", &a, &b, s) && parser.recv("OK\r\n")
+               && parser.recv("> \r\n");
+    });
+    link->set_response("XX", frame_of(frames, "recv"));
+    bench("read", frame_of(frames, "recv").size(), [&]() {
+        return parser.send("XX") && parser.read(data, sizeof(data)) > 0;
+    });
+
+    /* Helpers of the response decoding */
+    char number[] = "-12345";
+    char hex[] = "C47F51";
+    char security[] = "WPA2 AES";
+    bench("ParseNumber", sizeof(number) - 1, [&]() { sink += ParseNumber(number, NULL); return true; });
+    bench("ParseHexNumber", sizeof(hex) - 1, [&]() { sink += ParseHexNumber(hex, NULL); return true; });
+    bench("ParseSecurity", sizeof(security) - 1, [&]() { sink += ParseSecurity(security); return true; });
+
+    /* Recorded frames, through the check of the OK trailer common to all responses */
+    if (!recorded.empty()) {
+        size_t next = 0;
+        uint32_t bytes = 0;
+        for (size_t i = 0; i < recorded.size(); i++) {
+            bytes += recorded[i].frame.size();
+        }
+        bench("recorded", bytes / recorded.size(), [&]() {
+            link->set_response("XX", recorded[next].frame);
+            next = (next + 1) % recorded.size();
+            bool ok = parser.send("XX") && parser.recv("OK\r\n");
+            parser.flush();
+            return ok;
+        });
+    }
+
+    return 0;
+}
@@ -0,0 +1,261 @@
+/* Fuzz harness of the module response parsing
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @section DESCRIPTION
+ *
+ * The first byte of an input selects the driver call, the rest is the
+ * response frame of the module to its command. Built with libFuzzer when
+ * PARSER_FUZZ_LIBFUZZER is set, otherwise main() runs the files given on
+ * the command line, or the typical responses and mutations of them.
+ *
+ */
+
+#include <unistd.h>
+#include "ISM43362.h"
+#include "FrameTransport.h"
+#include "ResponseFrames.h"
+
+// Number of mutated inputs of the standalone run
+#ifndef PARSER_FUZZ_ITERATIONS
+#define PARSER_FUZZ_ITERATIONS 200000
+#endif
+
+extern "C" int32_t ParseNumber(char *ptr, uint8_t *cnt);
+extern "C" uint32_t ParseHexNumber(char *ptr, uint8_t *cnt);
+extern "C" nsapi_security_t ParseSecurity(char *ptr);
+
+enum fuzz_op {
+    OpStatus = 0,
+    OpNetmask,
+    OpGateway,
+    OpRssi,
+    OpVersion,
+    OpMac,
+    OpScan,
+    OpScanCount,
+    OpRecv,
+    OpRecvSmall,
+    OpSocket,
+    OpAccept,
+    OpDns,
+    OpClose,
+    OpRecvParser,
+    OpReadParser,
+    OpHelpers,
+
+    OpCount
+};
+
+static FrameTransport *_link;
+static ISM43362 *_wifi;
+static ATParser *_parser;
+
+static void fuzz_init(void)
+{
+    _link = new FrameTransport();
+    _wifi = new ISM43362(_link, NC, NC);
+    _parser = new ATParser(*_link);
+
+    /* Setup commands of the socket calls are accepted, only the fuzzed
+     * response reaches the parsing under test */
+    static const char *setup[] = { "P0", "P1", "P2", "P3", "P4", "P5", "R1", "R2", "S2" };
+    for (size_t i = 0; i < sizeof(setup) / sizeof(setup[0]); i++) {
+        _link->set_response(setup[i], "OK\r\n> ");
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static char buffer[ES_WIFI_RX_BUFFER_SIZE];
+    static WiFiAccessPoint ap[8];
+    char ip[NSAPI_IP_SIZE];
+    int port;
+    int a, b;
+
+    if (_wifi == NULL) {
+        fuzz_init();
+    }
+    if (size < 1) {
+        return 0;
+    }
+
+    std::string frame((const char *)data + 1, size - 1);
+    _link->clear();
+    _link->set_default(frame);
+
+    switch (data[0] % OpCount) {
+        case OpStatus:
+            _wifi->getIPAddress();
+            break;
+        case OpNetmask:
+            _wifi->getNetmask();
+            break;
+        case OpGateway:
+            _wifi->getGateway();
+            break;
+        case OpRssi:
+            _wifi->getRSSI();
+            break;
+        case OpVersion:
+            _wifi->get_firmware_version();
+            break;
+        case OpMac:
+            _wifi->getMACAddress();
+            break;
+        case OpScan:
+            _wifi->scan(ap, 8);
+            break;
+        case OpScanCount:
+            _wifi->scan(NULL, 0);
+            break;
+        case OpRecv:
+            _wifi->check_recv_status(data[0] & 3, buffer);
+            break;
+        case OpRecvSmall:
+            /* room for a few bytes only, the packet size follows */
+            _wifi->check_recv_status(data[0] & 3, buffer, 16 + (data[0] >> 2));
+            break;
+        case OpSocket:
+            _wifi->socket_status(data[0] & 3);
+            break;
+        case OpAccept:
+            _wifi->accept(data[0] & 3, ip, &port);
+            break;
+        case OpDns:
+            _wifi->dns_lookup("example.com", ip);
+            break;
+        case OpClose:
+            _wifi->close(data[0] & 3);
+            break;
+        case OpRecvParser:
+            _parser->send("XX") && _parser->recv("%d,%d,%7s\r\n", &a, &b, ip) && _parser->recv("OK\r\n")
+                && _parser->recv("> \r\n");
+            break;
+        case OpReadParser:
+            _parser->send("XX") && _parser->read(buffer, sizeof(buffer));
+            break;
+        case OpHelpers: {
+            /* The helpers work on null terminated fields of the responses */
+            std::string field(frame.c_str());
+            ParseNumber(&field[0], NULL);
+            ParseHexNumber(&field[0], NULL);
+            ParseSecurity(&field[0]);
+            break;
+        }
+    }
+
+    return 0;
+}
+
+#ifndef PARSER_FUZZ_LIBFUZZER
+
+static uint32_t random_state = 1;
+
+static uint32_t random_next(void)
+{
+    random_state = random_state * 1103515245 + 12345;
+    return random_state >> 8;
+}
+
+/* Byte flips, insertions of framing bytes, truncations and splices */
+static std::string mutate(const std::string &input, const std::vector<std::string> &seeds)
+{
+    static const char framing[] = { 0x15, '\r', '\n', '>', ' ', ',', '#', '%', '"', ':', 0 };
+    std::string out = input;
+    int count = 1 + random_next() % 8;
+
+    for (int i = 0; i < count; i++) {
+        size_t pos = out.empty() ? 0 : random_next() % out.size();
+        switch (random_next() % 6) {
+            case 0:
+                if (!out.empty()) {
+                    out[pos] ^= (char)(1 << (random_next() % 8));
+                }
+                break;
+            case 1:
+                out.insert(pos, 1, framing[random_next() % sizeof(framing)]);
+                break;
+            case 2:
+                out.resize(pos);
+                break;
+            case 3:
+                if (!out.empty()) {
+                    out.erase(pos, 1 + random_next() % 16);
+                }
+                break;
+            case 4: {
+                const std::string &other = seeds[random_next() % seeds.size()];
+                out.insert(pos, other.substr(random_next() % (other.size() + 1)));
+                break;
+            }
+            case 5:
+                out.insert(pos, std::string(1 + random_next() % 64, (char)random_next()));
+                break;
+        }
+    }
+
+    return out;
+}
+
+static void run(const std::string &input)
+{
+    LLVMFuzzerTestOneInput((const uint8_t *)input.data(), input.size());
+}
+
+int main(int argc, char **argv)
+{
+    /* Reproduce given inputs */
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            FILE *file = fopen(argv[i], "rb");
+            if (file == NULL) {
+                perror(argv[i]);
+                return 2;
+            }
+            std::string input;
+            char chunk[512];
+            size_t n;
+            while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+                input.append(chunk, n);
+            }
+            fclose(file);
+            run(input);
+        }
+        printf("%d input(s) run\r\n", argc - 1);
+        return 0;
+    }
+
+    /* Each typical response with each driver call, then mutations of them */
+    std::vector<response_frame_t> frames = response_frames();
+    std::vector<std::string> seeds;
+    for (size_t i = 0; i < frames.size(); i++) {
+        for (int op = 0; op < OpCount; op++) {
+            seeds.push_back(std::string(1, (char)op) + frames[i].frame);
+            run(seeds.back());
+        }
+    }
+    for (int i = 0; i < PARSER_FUZZ_ITERATIONS; i++) {
+        std::string input = mutate(seeds[random_next() % seeds.size()], seeds);
+        if (!input.empty()) {
+            input[0] = (char)(random_next() % 256);
+        }
+        run(input);
+    }
+
+    printf("%lu input(s) run\r\n", (unsigned long)(seeds.size() + PARSER_FUZZ_ITERATIONS));
+    return 0;
+}
+
+#endif
@@ -0,0 +1,286 @@
+/* ISM43362 driver run against a recorded SPI session
+ * Copyright (c) STMicroelectronics 2017
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <getopt.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ISM43362.h"
+#include "ISM43362Emulator.h"
+#include "SpiRecorder.h"
+#include "SpiReplay.h"
+
+// Pin of the emulated module reset line
+#define EMULATOR_RESET_PIN 1
+
+// Size of the recording of a session
+#define REPLAY_RECORDING_SIZE (64 * 1024)
+
+// Max reads waiting for the echo, the replay reads the same number as the recording
+#define REPLAY_MAX_READS 1000
+
+static int failures;
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: %s\r\n", __FILE__, __LINE__, #cond); \
+            failures++; \
+        } \
+    } while (0)
+
+/* What the driver got from the module during a session */
+typedef struct {
+    std::string version;
+    std::string mac;
+    std::string ip;
+    std::string dns;
+    int rssi;
+    int status;
+    std::string echo;
+    bool ok;
+} session_t;
+
+static const char session_data[] = "replayed session";
+
+/* Session run once against the emulated module, then against its recording */
+static void session(ISM43362 &wifi, int port, session_t *s)
+{
+    const char *str;
+    char addr[NSAPI_IP_SIZE];
+    char rx[ES_WIFI_RX_BUFFER_SIZE];
+
+    *s = session_t();
+    s->ok = true;
+    str = wifi.get_firmware_version();
+    s->version = str ? str : "";
+    str = wifi.getMACAddress();
+    s->mac = str ? str : "";
+    s->ok = s->ok && wifi.dhcp(true) && wifi.connect("emulator", "password");
+    str = wifi.getIPAddress();
+    s->ip = str ? str : "";
+    s->rssi = wifi.getRSSI();
+    s->dns = wifi.dns_lookup("localhost", addr) ? addr : "";
+
+    s->ok = s->ok && wifi.open("0", 0, "127.0.0.1", port);
+    s->ok = s->ok && wifi.send(0, session_data, sizeof(session_data));
+    for (int i = 0; (i < REPLAY_MAX_READS) && (s->echo.size() < sizeof(session_data)); i++) {
+        int n = wifi.check_recv_status(0, rx);
+        if (n < 0) {
+            break;
+        }
+        s->echo.append(rx, n);
+    }
+    s->status = wifi.socket_status(0);
+    s->ok = s->ok && wifi.close(0) && wifi.disconnect();
+}
+
+static void tcp_echo(int fd)
+{
+    char buf[2048];
+    int client = accept(fd, NULL, NULL);
+    ssize_t n;
+
+    while ((n = recv(client, buf, sizeof(buf), 0)) > 0) {
+        send(client, buf, n, MSG_NOSIGNAL);
+    }
+    close(client);
+    close(fd);
+}
+
+static int echo_start(void)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+            || getsockname(fd, (struct sockaddr *)&addr, &len) < 0 || listen(fd, 1) < 0) {
+        perror("bind");
+        exit(2);
+    }
+    std::thread(tcp_echo, fd).detach();
+    return ntohs(addr.sin_port);
+}
+
+static void dump_append(std::vector<uint8_t> *out, const uint8_t *data, uint32_t len)
+{
+    out->insert(out->end(), data, data + len);
+}
+
+/* Record a session of the driver with the emulated module, returns the echo port */
+static int record(std::vector<uint8_t> *recording, session_t *s)
+{
+    static uint8_t buffer[REPLAY_RECORDING_SIZE];
+    SpiRecorder recorder(buffer, sizeof(buffer));
+    ISM43362Emulator *module = new ISM43362Emulator(EMULATOR_RESET_PIN);
+
+    /* Recorded from the boot prompt read by the constructor */
+    module->record(&recorder);
+    int port = echo_start();
+    {
+        ISM43362 wifi(module, EMULATOR_RESET_PIN, NC);
+        session(wifi, port, s);
+        recorder.dump(callback(recording, dump_append));
+    }
+    return port;
+}
+
+/* Replay a recording, returns the number of frames written differently */
+static uint32_t replay(const std::vector<uint8_t> &recording, int port, session_t *s, bool *done)
+{
+    SpiReplay *link = new SpiReplay(recording.data(), recording.size());
+    ISM43362 wifi(link, NC, NC);
+
+    session(wifi, port, s);
+    *done = link->done();
+    return link->mismatches();
+}
+
+static bool load(const char *path, std::vector<uint8_t> *data)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t buf[1024];
+    size_t n;
+
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data->insert(data->end(), buf, buf + n);
+    }
+    fclose(f);
+    return true;
+}
+
+static bool save(const char *path, const std::vector<uint8_t> &data)
+{
+    FILE *f = fopen(path, "wb");
+
+    if ((f == NULL) || (fwrite(data.data(), 1, data.size(), f) != data.size())) {
+        perror(path);
+        if (f) {
+            fclose(f);
+        }
+        return false;
+    }
+    fclose(f);
+    return true;
+}
+
+static void usage(const char *name)
+{
+    printf("Usage: %s [-i recording -p port] [-o recording]\r\n", name);
+    printf("  Records a session of the driver with the emulated module, or loads it with -i,\r\n");
+    printf("  then replays it and checks the driver gets the same responses\r\n");
+    printf("  -p is the echo server port of the loaded session\r\n");
+    printf("  -o saves the recording, as exported by SpiRecorder::dump\r\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *input = NULL;
+    const char *output = NULL;
+    int port = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:o:p:h")) != -1) {
+        switch (opt) {
+            case 'i':
+                input = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'p':
+                port = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    std::vector<uint8_t> recording;
+    session_t recorded;
+    session_t replayed;
+    bool done;
+
+    if (input != NULL) {
+        if (!load(input, &recording)) {
+            return 2;
+        }
+        /* Only the replay is checked against the recording */
+        CHECK(replay(recording, port, &replayed, &done) == 0);
+        CHECK(done);
+        CHECK(replayed.ok);
+        printf("%s: %d failure(s)\r\n", failures ? "FAILED" : "PASSED", failures);
+        return failures ? 1 : 0;
+    }
+
+    port = record(&recording, &recorded);
+    CHECK(recorded.ok);
+    CHECK(recorded.version == "C3.5.2.5.STM");
+    CHECK(recorded.echo == std::string(session_data, sizeof(session_data)));
+    if ((output != NULL) && !save(output, recording)) {
+        return 2;
+    }
+    printf("recorded %lu bytes, echo port %d\r\n", (unsigned long)recording.size(), port);
+
+    /* The replay gets the recorded responses, and writes the recorded commands */
+    CHECK(replay(recording, port, &replayed, &done) == 0);
+    CHECK(done);
+    CHECK(replayed.ok);
+    CHECK(replayed.version == recorded.version);
+    CHECK(replayed.mac == recorded.mac);
+    CHECK(replayed.ip == recorded.ip);
+    CHECK(replayed.dns == recorded.dns);
+    CHECK(replayed.rssi == recorded.rssi);
+    CHECK(replayed.echo == recorded.echo);
+    CHECK(replayed.status == recorded.status);
+
+    /* A response changed in the recording is what the driver gets */
+    std::vector<uint8_t> altered = recording;
+    std::string mac = recorded.mac;
+    std::vector<uint8_t>::iterator it = std::search(altered.begin(), altered.end(), mac.begin(), mac.end());
+    CHECK(it != altered.end());
+    if (it != altered.end()) {
+        *(it + mac.size() - 1) ^= 1;
+        CHECK(replay(altered, port, &replayed, &done) == 0);
+        CHECK(replayed.mac != recorded.mac && replayed.mac.size() == recorded.mac.size());
+        CHECK(replayed.version == recorded.version);
+    }
+
+    /* A command that differs from the recording is reported */
+    CHECK(replay(recording, port + 1, &replayed, &done) == 1);
+    CHECK(replayed.echo == recorded.echo);
+
+    /* So is a session going past the end of the recording */
+    std::vector<uint8_t> truncated(recording.begin(), recording.begin() + recording.size() / 2);
+    CHECK(replay(truncated, port, &replayed, &done) > 0);
+    CHECK(done && !replayed.ok);
+
+    printf("%s: %d failure(s)\r\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}